@@ -0,0 +1,243 @@
+#include "BenchFens.h"
+#include "EvalCache.h"
+#include "MCTS.h"
+#include "MinMax.h"
+#include "ParseNumber.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// results are folded in here so the timed calls cannot be optimised away
+static volatile uint64_t sink;
+
+static void usage() {
+    std::printf("usage: chessbench_micro [samples] [filter]\n");
+    std::printf("  samples  timed samples per benchmark after warm-up (default 50)\n");
+    std::printf("  filter   only run benchmarks whose name contains this\n");
+}
+
+namespace {
+
+struct Position {
+    chess::Board board;
+    chess::Movelist moves;
+    std::vector<std::string> uciMoves;
+};
+
+struct Summary {
+    double median;
+    double p5;
+    double p95;
+    double min;
+};
+
+const int WARMUP_SAMPLES = 5;
+// every sample calls the body this many times over the whole position set
+const int CALLS_PER_SAMPLE = 64;
+
+double percentile(std::vector<double> &sorted, double p) {
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// body runs once per position and returns how many calls it made there, the summary is in nanoseconds per call
+Summary measure(std::vector<Position> &positions, int samples, const std::function<int(Position &)> &body) {
+    std::vector<double> perCall;
+    perCall.reserve(samples);
+
+    for (int s = 0; s < WARMUP_SAMPLES + samples; s++) {
+        long long calls = 0;
+        auto begin = Clock::now();
+
+        for (int r = 0; r < CALLS_PER_SAMPLE; r++) {
+            for (Position &position : positions)
+                calls += body(position);
+        }
+
+        double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - begin).count();
+        if (s >= WARMUP_SAMPLES)
+            perCall.push_back(nanoseconds / std::max(1LL, calls));
+    }
+
+    std::sort(perCall.begin(), perCall.end());
+    return {percentile(perCall, 0.5), percentile(perCall, 0.05), percentile(perCall, 0.95), perCall.front()};
+}
+
+// fills the root's children with made up statistics so selection has something to weigh
+void fakeStatistics(xoxo::Node *root) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    double prior = 1.0 / std::max<size_t>(1, root->children.size());
+
+    for (size_t i = 0; i < root->children.size(); i++) {
+        xoxo::Node *child = root->children[i];
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        child->visits = 1 + static_cast<int>((state >> 33) % 100);
+        child->wins = child->visits * static_cast<double>((state >> 20) % 1000) / 1000.0;
+        root->edges[i].prior = prior;
+        root->edges[i].visits = child->visits;
+        root->visits += child->visits;
+        root->wins += child->wins;
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int samples = 50;
+    if (argc > 1 && !xoxo::parseNumber(argv[1], samples)) {
+        usage();
+        return 1;
+    }
+    std::string filter = argc > 2 ? argv[2] : "";
+
+    if (samples <= 0) {
+        usage();
+        return 1;
+    }
+
+    std::vector<Position> positions;
+    for (const char *fen : BENCH_FENS) {
+        Position position{chess::Board(fen), {}, {}};
+        chess::movegen::legalmoves(position.moves, position.board);
+        for (const chess::Move &move : position.moves)
+            position.uciMoves.push_back(chess::uci::moveToUci(move));
+        positions.push_back(position);
+    }
+
+    // selection reads an already expanded tree, built once outside the timing
+    xoxo::NodePool pool;
+    std::vector<xoxo::Node *> roots;
+    for (Position &position : positions) {
+        xoxo::Node *root = pool.create(position.board, nullptr, nullptr, position.board.sideToMove());
+        root->expand(pool);
+        fakeStatistics(root);
+        roots.push_back(root);
+    }
+
+    std::vector<std::pair<std::string, std::function<int(Position &)>>> benchmarks = {
+        {"MinMax::getMaterialScore",
+         [](Position &p) {
+             sink = sink + MinMax::getMaterialScore(p.board);
+             return 1;
+         }},
+        {"MinMax::getMobilityScore",
+         [](Position &p) {
+             sink = sink + MinMax::getMobilityScore(p.board);
+             return 1;
+         }},
+        {"MinMax::getKingSafety",
+         [](Position &p) {
+             sink = sink + MinMax::getKingSafety(p.board);
+             return 1;
+         }},
+        // a handful of positions stay in the eval cache, so this is the cache hit path
+        {"MinMax::getBoardScore hit",
+         [](Position &p) {
+             sink = sink + MinMax::getBoardScore(p.board);
+             return 1;
+         }},
+        // the position is dropped from the cache first, so every call evaluates and stores; the pawn hash stays warm
+        {"MinMax::getBoardScore miss",
+         [](Position &p) {
+             xoxo::EvalCache::minmax().forget(p.board.hash());
+             sink = sink + MinMax::getBoardScore(p.board);
+             return 1;
+         }},
+        {"xoxo::getMaterialScore",
+         [](Position &p) {
+             sink = sink + xoxo::getMaterialScore(p.board);
+             return 1;
+         }},
+        {"xoxo::getBoardScore hit",
+         [](Position &p) {
+             sink = sink + xoxo::getBoardScore(p.board);
+             return 1;
+         }},
+        {"xoxo::getBoardScore miss",
+         [](Position &p) {
+             xoxo::EvalCache::mcts().forget(p.board.hash());
+             sink = sink + xoxo::getBoardScore(p.board);
+             return 1;
+         }},
+        {"movegen::legalmoves",
+         [](Position &p) {
+             chess::Movelist moves;
+             chess::movegen::legalmoves(moves, p.board);
+             sink = sink + moves.size();
+             return 1;
+         }},
+        // per move
+        {"Board::makeMove+unmakeMove",
+         [](Position &p) {
+             for (const chess::Move &move : p.moves) {
+                 p.board.makeMove(move);
+                 sink = sink + p.board.hash();
+                 p.board.unmakeMove(move);
+             }
+             return static_cast<int>(p.moves.size());
+         }},
+        {"Board::isGameOver",
+         [](Position &p) {
+             sink = sink + static_cast<int>(p.board.isGameOver().second);
+             return 1;
+         }},
+        // includes giving the children back to the pool
+        {"Node::expand",
+         [&pool](Position &p) {
+             xoxo::Node *node = pool.create(p.board, nullptr, nullptr, p.board.sideToMove());
+             node->expand(pool);
+             sink = sink + node->children.size();
+             pool.destroy(node);
+             return 1;
+         }},
+        {"Node::selectChild UCB1",
+         [&roots, &positions](Position &p) {
+             xoxo::Node *root = roots[&p - positions.data()];
+             sink = sink + reinterpret_cast<uintptr_t>(root->selectChild(xoxo::SelectionPolicy::UCB1));
+             return 1;
+         }},
+        {"Node::selectChild PUCT",
+         [&roots, &positions](Position &p) {
+             xoxo::Node *root = roots[&p - positions.data()];
+             sink = sink + reinterpret_cast<uintptr_t>(root->selectChild(xoxo::SelectionPolicy::PUCT));
+             return 1;
+         }},
+        // per move
+        {"uci::moveToUci",
+         [](Position &p) {
+             for (const chess::Move &move : p.moves)
+                 sink = sink + chess::uci::moveToUci(move).size();
+             return static_cast<int>(p.moves.size());
+         }},
+        // per move
+        {"uci::uciToMove",
+         [](Position &p) {
+             for (const std::string &uci : p.uciMoves)
+                 sink = sink + chess::uci::uciToMove(p.board, uci).move();
+             return static_cast<int>(p.uciMoves.size());
+         }},
+    };
+
+    std::printf("%-30s %12s %12s %12s %12s\n", "benchmark", "median ns", "p5 ns", "p95 ns", "min ns");
+
+    for (auto &[name, body] : benchmarks) {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            continue;
+
+        Summary summary = measure(positions, samples, body);
+        std::printf("%-30s %12.1f %12.1f %12.1f %12.1f\n", name.c_str(), summary.median, summary.p5, summary.p95,
+                    summary.min);
+    }
+
+    for (xoxo::Node *root : roots)
+        pool.destroy(root);
+
+    return 0;
+}
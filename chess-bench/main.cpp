@@ -0,0 +1,681 @@
+#include "BenchFens.h"
+#include "AllocationProfiler.h"
+#include "BatchEval.h"
+#include "EngineMemory.h"
+#include "EvalCache.h"
+#include "MCTS.h"
+#include "MateSolver.h"
+#include "PerfCounters.h"
+#include "SearchTrace.h"
+#include "MinMax.h"
+#include "ParseNumber.h"
+#include "PawnHash.h"
+#include "SEE.h"
+#include "TranspositionTable.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void usage() {
+    std::printf("usage: chessbench <mode> [iterations]\n");
+    std::printf("  batch    MCTS::searchBatched throughput for batch sizes 1..%d\n", xoxo::MAX_EVAL_BATCH);
+    std::printf("  solver   iterations MCTS needs to prove forced mates, against the nodes of the df-pn mate solver\n");
+    std::printf("  terminal cost of Board::isGameOver against xoxo::getTerminal per node\n");
+    std::printf("  hybrid   MCTS value accuracy per CPU-second, rollouts against alpha-beta leaves\n");
+    std::printf("  stable   iterations until the best move stops changing, UCB1 against PUCT\n");
+    std::printf("  memory   engine memory arena usage of the tables and the MCTS node pool\n");
+    std::printf("  see      nanoseconds per static exchange evaluation of every legal move in the bench set\n");
+    std::printf("  search   alpha-beta nodes per second, iterations thousand nodes per position\n");
+    std::printf("  halving  best-move agreement with deep alpha-beta per budget, PUCT against sequential halving\n");
+    std::printf("  dag      MCTS as a tree against MCTS sharing transposed positions, nodes and merged-node ratio\n");
+    std::printf("  counters hardware counters per MCTS phase and per alpha-beta movegen and eval, as json\n");
+    std::printf("  alloc    allocations per MCTS iteration and per alpha-beta node, by component and size class\n");
+    std::printf("  gc       MCTS held to a quarter of its unbounded node count, collections and best-move agreement\n");
+    std::printf("  trace    MCTS and alpha-beta speed with the search trace recorder stopped and started\n");
+}
+
+// iterations per second of the batched search over the bench set, one row per batch size
+static int benchBatch(int iterations) {
+    std::printf("%8s %12s %14s\n", "batch", "iterations", "iterations/s");
+
+    for (int batch = 1; batch <= xoxo::MAX_EVAL_BATCH; batch *= 2) {
+        long long total = 0;
+        auto begin = Clock::now();
+
+        for (const char *fen : BENCH_FENS) {
+            chess::Board board(fen);
+            xoxo::MCTS mcts(&board);
+            mcts.searchBatched(iterations, batch);
+            total += iterations;
+        }
+
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        std::printf("%8d %12lld %14.0f\n", batch, total, total / seconds);
+    }
+
+    return 0;
+}
+
+// iterations until the root is proven, or the full budget when it never is. then whole mates played out the way the
+// engine plays them, one solve per attacker move on a table that is never cleared in between
+static int benchSolver(int iterations) {
+    static const char *mates[] = {
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR w KQkq - 0 1",
+        "k7/8/1K6/8/8/8/8/7R w - - 0 1",
+        "k7/pp6/8/8/8/8/8/K5RR w - - 0 1",
+    };
+    static const char *lines[] = {
+        "8/8/8/7k/R7/8/8/1R4K1 w - - 0 1",
+        "r5rk/5p1p/5R2/4B3/8/8/7P/7K w - - 0 1",
+    };
+
+    xoxo::MateSolver *solver = xoxo::MateSolver::local();
+    if (solver == nullptr) {
+        std::fprintf(stderr, "no engine memory left for the mate solver's table\n");
+        return 1;
+    }
+
+    std::printf("%-70s %10s %8s %6s %10s %10s %6s\n", "fen", "iterations", "proven", "move", "pn nodes", "pn ms",
+                "mate");
+
+    for (const char *fen : mates) {
+        chess::Board board(fen);
+        xoxo::MCTS mcts(&board);
+        int used = mcts.search(iterations);
+        xoxo::Node *best = mcts.getBestNode();
+
+        solver->clear();
+        chess::Move mate;
+        auto begin = Clock::now();
+        bool proven = solver->solve(board, xoxo::RepetitionStack(), mate);
+        double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+        std::printf("%-70s %10d %8d %6s %10llu %10.2f %6s\n", fen, used, mcts.provenNodes,
+                    best ? best->uciString.c_str() : "-", (unsigned long long)solver->nodes, milliseconds,
+                    proven ? chess::uci::moveToUci(mate).c_str() : "-");
+    }
+
+    // the defender always answers with its first legal move, every solve on the way has to find the mate again
+    std::printf("\n%-70s %8s %8s %8s\n", "line", "solves", "proven", "mated");
+
+    for (const char *fen : lines) {
+        chess::Board board(fen);
+        xoxo::RepetitionStack history;
+        const chess::Color attacker = board.sideToMove();
+        int solves = 0;
+        int proven = 0;
+        solver->clear();
+
+        while (true) {
+            chess::Movelist moves;
+            chess::movegen::legalmoves(moves, board);
+            if (moves.empty())
+                break;
+
+            chess::Move move = moves[0];
+            if (board.sideToMove() == attacker) {
+                solves++;
+                if (!solver->solve(board, history, move))
+                    break;
+                proven++;
+            }
+
+            history.push(board.hash());
+            board.makeMove(move);
+        }
+
+        std::printf("%-70s %8d %8d %8s\n", fen, solves, proven, board.inCheck() ? "yes" : "no");
+    }
+
+    return 0;
+}
+
+// both sides of the comparison walk the same children; getTerminal is handed the move list the search generates
+// for the node anyway, so only the classification itself is timed
+static int benchTerminal(int iterations) {
+    long long nodes = 0;
+    int checksum = 0;
+    double gameOverSeconds = 0;
+    double terminalSeconds = 0;
+    xoxo::RepetitionStack repetitions;
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        chess::Movelist rootMoves;
+        chess::movegen::legalmoves(rootMoves, board);
+
+        for (const chess::Move &move : rootMoves) {
+            board.makeMove(move);
+            chess::Movelist moves;
+            chess::movegen::legalmoves(moves, board);
+
+            auto begin = Clock::now();
+            for (int i = 0; i < iterations; i++)
+                checksum += static_cast<int>(board.isGameOver().first);
+            auto middle = Clock::now();
+            for (int i = 0; i < iterations; i++)
+                checksum += static_cast<int>(xoxo::getTerminal(board, moves, &repetitions));
+            auto end = Clock::now();
+
+            gameOverSeconds += std::chrono::duration<double>(middle - begin).count();
+            terminalSeconds += std::chrono::duration<double>(end - middle).count();
+            nodes += iterations;
+            board.unmakeMove(move);
+        }
+    }
+
+    std::printf("%-12s %10.1f ns/node\n", "isGameOver", gameOverSeconds * 1e9 / nodes);
+    std::printf("%-12s %10.1f ns/node\n", "getTerminal", terminalSeconds * 1e9 / nodes);
+    std::printf("checksum %d\n", checksum);
+    return 0;
+}
+
+struct Reference {
+    // win probability for the side to move
+    double value;
+    std::string move;
+};
+
+// a deeper alpha-beta search of every bench position, the truth the MCTS variants are scored against
+static std::vector<Reference> referenceSearches() {
+    std::vector<Reference> references;
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        MinMax::SearchContext context;
+        context.maxDepth = 5;
+        context.deadline = Clock::now() + std::chrono::seconds(2);
+        chess::Move move;
+        int score = MinMax::searchPosition(board, context, move);
+        references.push_back({xoxo::scoreToWinProbability(score), chess::uci::moveToUci(move)});
+    }
+
+    // the reference searches filled the table, nobody gets them for free
+    xoxo::TranspositionTable::shared().clear();
+    return references;
+}
+
+// each leaf evaluation mode is scored on how close the root value gets to the reference and how often it agrees on
+// the move, against the time it spent
+static int benchHybrid(int iterations) {
+    std::vector<Reference> references = referenceSearches();
+
+    std::printf("%-12s %12s %10s %10s %14s\n", "leaves", "mean error", "agreement", "seconds", "accuracy/s");
+
+    for (xoxo::LeafEvaluation mode : {xoxo::LeafEvaluation::ROLLOUT, xoxo::LeafEvaluation::ALPHA_BETA}) {
+        // nor what the previous mode left in it
+        xoxo::TranspositionTable::shared().clear();
+
+        double error = 0;
+        int agreement = 0;
+        double seconds = 0;
+
+        for (size_t i = 0; i < BENCH_FENS.size(); i++) {
+            chess::Board board(BENCH_FENS[i]);
+            xoxo::MCTS mcts(&board);
+            mcts.leafEvaluation = mode;
+
+            auto begin = Clock::now();
+            mcts.search(iterations);
+            seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+
+            double value = mcts.root->wins / std::max(1, mcts.root->visits);
+            xoxo::Node *best = mcts.getBestNode();
+            error += std::abs(value - references[i].value);
+            agreement += best != nullptr && best->uciString == references[i].move;
+        }
+
+        double meanError = error / BENCH_FENS.size();
+        std::printf("%-12s %12.4f %7d/%-2zu %10.3f %14.4f\n",
+                    mode == xoxo::LeafEvaluation::ROLLOUT ? "rollout" : "alpha-beta", meanError, agreement,
+                    BENCH_FENS.size(), seconds, (1.0 - meanError) / seconds);
+    }
+
+    return 0;
+}
+
+// the search runs in slices; the last slice after which getBestNode changed its mind is where the move became stable
+static int benchStable(int iterations) {
+    const int slice = 25;
+
+    std::printf("%-8s %16s %12s\n", "policy", "mean stable at", "seconds");
+
+    for (xoxo::SelectionPolicy policy : {xoxo::SelectionPolicy::UCB1, xoxo::SelectionPolicy::PUCT}) {
+        long long stableSum = 0;
+        double seconds = 0;
+
+        for (const char *fen : BENCH_FENS) {
+            chess::Board board(fen);
+            xoxo::MCTS mcts(&board);
+            mcts.selectionPolicy = policy;
+
+            std::string best;
+            int stableAt = 0;
+            auto begin = Clock::now();
+
+            for (int done = 0; done < iterations; done += slice) {
+                mcts.search(slice);
+                xoxo::Node *node = mcts.getBestNode();
+                std::string move = node != nullptr ? node->uciString : "";
+
+                if (move != best) {
+                    best = move;
+                    stableAt = done + slice;
+                }
+            }
+
+            seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+            stableSum += stableAt;
+        }
+
+        std::printf("%-8s %16.1f %12.3f\n", policy == xoxo::SelectionPolicy::UCB1 ? "ucb1" : "puct",
+                    static_cast<double>(stableSum) / BENCH_FENS.size(), seconds);
+    }
+
+    return 0;
+}
+
+// tree size and pool footprint per position, then where the engine memory budget went
+static int benchMemory(int iterations) {
+    std::printf("%-70s %10s %10s %12s\n", "fen", "nodes", "pool MB", "bytes/node");
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        xoxo::MCTS mcts(&board);
+        mcts.leafEvaluation = xoxo::LeafEvaluation::ALPHA_BETA;
+        mcts.search(iterations);
+
+        double nodes = static_cast<double>(mcts.pool.size());
+        std::printf("%-70s %10.0f %10.1f %12.0f\n", fen, nodes, mcts.pool.bytes() / (1024.0 * 1024.0),
+                    nodes > 0 ? mcts.pool.bytes() / nodes : 0.0);
+    }
+
+    std::printf("%s", xoxo::EngineMemory::global().report().c_str());
+    return 0;
+}
+
+// every legal move of the bench set through xoxo::see, iterations times over
+static int benchSee(int iterations) {
+    std::vector<chess::Board> boards;
+    std::vector<chess::Movelist> moves;
+    for (const char *fen : BENCH_FENS) {
+        boards.emplace_back(fen);
+        moves.emplace_back();
+        chess::movegen::legalmoves(moves.back(), boards.back());
+    }
+
+    long long calls = 0;
+    long long losing = 0;
+    auto begin = Clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        for (size_t b = 0; b < boards.size(); b++) {
+            for (const chess::Move &move : moves[b]) {
+                losing += xoxo::see(boards[b], move) < 0;
+                calls++;
+            }
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    std::printf("%12s %12s %10s\n", "calls", "losing", "ns/call");
+    std::printf("%12lld %12lld %10.1f\n", calls, losing, seconds * 1e9 / std::max(1LL, calls));
+    return 0;
+}
+
+// MinMax::searchPosition on a cold transposition table and eval cache for every bench position, then how often the
+// pawn hash answered an evaluation
+static int benchSearch(int iterations) {
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    xoxo::PawnHashTable &pawns = xoxo::PawnHashTable::local();
+    pawns.clear();
+
+    std::printf("%-70s %6s %10s %10s\n", "fen", "depth", "nodes", "nps");
+
+    for (const char *fen : BENCH_FENS) {
+        xoxo::TranspositionTable::shared().clear();
+        xoxo::EvalCache::minmax().clear();
+
+        chess::Board board(fen);
+        MinMax::SearchContext context;
+        context.nodeLimit = static_cast<uint64_t>(iterations) * 1000;
+
+        chess::Move best = chess::Move::NO_MOVE;
+        auto begin = Clock::now();
+        MinMax::searchPosition(board, context, best);
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        totalNodes += context.nodes;
+        totalSeconds += seconds;
+        std::printf("%-70s %6d %10llu %10.0f\n", fen, context.completedDepth, (unsigned long long)context.nodes,
+                    context.nodes / seconds);
+    }
+
+    std::printf("total %llu nodes, %.0f nps\n", (unsigned long long)totalNodes, totalNodes / totalSeconds);
+    std::printf("pawn hash %llu probes, %llu hits, %llu misses, %.1f%% hit rate\n", (unsigned long long)pawns.probes,
+                (unsigned long long)pawns.hits, (unsigned long long)(pawns.probes - pawns.hits),
+                100 * pawns.hitRate());
+    return 0;
+}
+
+// every root policy is scored on how often it finds the reference move at an eighth, a quarter, half and all of the
+// budget
+static int benchHalving(int iterations) {
+    std::vector<Reference> references = referenceSearches();
+
+    struct Variant {
+        const char *name;
+        xoxo::RootPolicy policy;
+        int topK;
+    };
+    const Variant variants[] = {{"puct", xoxo::RootPolicy::SELECTION, 0},
+                                {"halving", xoxo::RootPolicy::SEQUENTIAL_HALVING, 0},
+                                {"gumbel-16", xoxo::RootPolicy::SEQUENTIAL_HALVING, 16}};
+
+    std::printf("%-10s %10s %10s %10s\n", "root", "budget", "agreement", "seconds");
+
+    for (const Variant &variant : variants) {
+        for (int budget = std::max(1, iterations / 8); budget <= iterations; budget *= 2) {
+            int agreement = 0;
+            double seconds = 0;
+
+            for (size_t i = 0; i < BENCH_FENS.size(); i++) {
+                chess::Board board(BENCH_FENS[i]);
+                xoxo::MCTS mcts(&board);
+                mcts.rootPolicy = variant.policy;
+                mcts.gumbelTopK = variant.topK;
+
+                auto begin = Clock::now();
+                mcts.search(budget);
+                seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+
+                xoxo::Node *best = mcts.getBestNode();
+                agreement += best != nullptr && best->uciString == references[i].move;
+            }
+
+            std::printf("%-10s %10d %7d/%-2zu %10.3f\n", variant.name, budget, agreement, BENCH_FENS.size(), seconds);
+        }
+    }
+
+    return 0;
+}
+
+// the same search with and without transpositions: nodes and pool memory each needs, and the share of expansion
+// edges that found their position already in the graph
+static int benchDag(int iterations) {
+    std::printf("%-70s %10s %10s %10s %10s %8s %12s %12s\n", "fen", "tree nodes", "dag nodes", "tree MB", "dag MB",
+                "merged", "tree it/s", "dag it/s");
+
+    uint64_t treeNodes = 0, dagNodes = 0, edges = 0, mergedEdges = 0;
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        uint64_t nodes[2];
+        double megabytes[2];
+        double rate[2];
+        double merged = 0;
+
+        for (int dag = 0; dag < 2; dag++) {
+            xoxo::MCTS mcts(&board);
+            mcts.transpositions = dag == 1;
+
+            auto begin = Clock::now();
+            int used = mcts.search(iterations);
+            double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+            nodes[dag] = mcts.pool.size();
+            megabytes[dag] = mcts.pool.bytes() / (1024.0 * 1024.0);
+            rate[dag] = used / seconds;
+
+            if (dag == 1) {
+                merged = mcts.table.mergedRatio();
+                edges += mcts.table.edges;
+                mergedEdges += mcts.table.mergedEdges;
+            }
+        }
+
+        treeNodes += nodes[0];
+        dagNodes += nodes[1];
+        std::printf("%-70s %10llu %10llu %10.1f %10.1f %7.1f%% %12.0f %12.0f\n", fen, (unsigned long long)nodes[0],
+                    (unsigned long long)nodes[1], megabytes[0], megabytes[1], merged * 100.0, rate[0], rate[1]);
+    }
+
+    std::printf("total %llu tree nodes, %llu dag nodes, %.1f%% of edges merged\n", (unsigned long long)treeNodes,
+                (unsigned long long)dagNodes, edges > 0 ? 100.0 * mergedEdges / edges : 0.0);
+    return 0;
+}
+
+// the unbounded search sets the ceiling of the bounded one to a quarter of its final node count, so every position
+// collects several times. agreement is how often both searches end on the same move
+static int benchGc(int iterations) {
+    std::printf("%-70s %10s %10s %6s %10s %12s %12s %6s\n", "fen", "full nodes", "max nodes", "gcs", "collected",
+                "full it/s", "bounded it/s", "same");
+
+    int agreement = 0;
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+
+        xoxo::MCTS full(&board);
+        auto begin = Clock::now();
+        int fullUsed = full.search(iterations);
+        double fullSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        xoxo::MCTS bounded(&board);
+        bounded.maxNodes = std::max<uint64_t>(64, full.pool.size() / 4);
+        begin = Clock::now();
+        int boundedUsed = bounded.search(iterations);
+        double boundedSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+        xoxo::Node *fullBest = full.getBestNode();
+        xoxo::Node *boundedBest = bounded.getBestNode();
+        bool same = fullBest != nullptr && boundedBest != nullptr && fullBest->move == boundedBest->move;
+        agreement += same;
+
+        std::printf("%-70s %10llu %10llu %6d %10llu %12.0f %12.0f %6s\n", fen, (unsigned long long)full.pool.size(),
+                    (unsigned long long)bounded.maxNodes, bounded.collections,
+                    (unsigned long long)bounded.collectedNodes, fullUsed / fullSeconds, boundedUsed / boundedSeconds,
+                    same ? "yes" : "no");
+    }
+
+    std::printf("same best move in %d/%zu positions\n", agreement, BENCH_FENS.size());
+    return 0;
+}
+
+// MCTS with rollouts and with alpha-beta leaves, then plain alpha-beta, each over the whole bench set. phases nest,
+// so the movegen and eval of the MCTS runs are part of their simulate phase as well
+static int benchCounters(int iterations) {
+    xoxo::enablePerfCounters(true);
+    if (!xoxo::PerfCounters::local().available())
+        std::fprintf(stderr, "hardware counters are not available here, only phase calls are counted\n");
+    xoxo::takePerfTotals();
+
+    std::printf("{\n");
+
+    for (xoxo::LeafEvaluation leaves : {xoxo::LeafEvaluation::ROLLOUT, xoxo::LeafEvaluation::ALPHA_BETA}) {
+        for (const char *fen : BENCH_FENS) {
+            chess::Board board(fen);
+            xoxo::MCTS mcts(&board);
+            mcts.leafEvaluation = leaves;
+            mcts.search(iterations);
+        }
+
+        std::printf("  \"%s\": %s,\n", leaves == xoxo::LeafEvaluation::ROLLOUT ? "mcts_rollout" : "mcts_alpha_beta",
+                    xoxo::takePerfTotals().json().c_str());
+    }
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        MinMax::SearchContext context;
+        context.nodeLimit = static_cast<uint64_t>(iterations) * 1000;
+        chess::Move best = chess::Move::NO_MOVE;
+        MinMax::searchPosition(board, context, best);
+    }
+
+    std::printf("  \"alpha_beta\": %s\n}\n", xoxo::takePerfTotals().json().c_str());
+
+    xoxo::enablePerfCounters(false);
+    return 0;
+}
+
+// the same searches as the counters mode. the figures are per iteration for MCTS and per node for alpha-beta, so
+// allocation work can be measured against the numbers of an earlier run
+static int benchAlloc(int iterations) {
+    if (!xoxo::allocationProfiling()) {
+        std::fprintf(stderr, "chessbench alloc needs chess-bot built with -DCHESS_ALLOC_PROFILE=ON\n");
+        return 1;
+    }
+
+    for (xoxo::LeafEvaluation leaves : {xoxo::LeafEvaluation::ROLLOUT, xoxo::LeafEvaluation::ALPHA_BETA}) {
+        uint64_t used = 0;
+        xoxo::AllocationStats stats;
+
+        for (const char *fen : BENCH_FENS) {
+            chess::Board board(fen);
+            xoxo::takeAllocationStats();
+            {
+                xoxo::MCTS mcts(&board);
+                mcts.leafEvaluation = leaves;
+                used += mcts.search(iterations);
+            }
+            stats.add(xoxo::takeAllocationStats());
+        }
+
+        std::printf("%s, per iteration\n%s\n",
+                    leaves == xoxo::LeafEvaluation::ROLLOUT ? "mcts rollout" : "mcts alpha-beta leaves",
+                    stats.report(used).c_str());
+    }
+
+    uint64_t nodes = 0;
+    xoxo::AllocationStats stats;
+
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        MinMax::SearchContext context;
+        context.nodeLimit = static_cast<uint64_t>(iterations) * 1000;
+        chess::Move best = chess::Move::NO_MOVE;
+
+        xoxo::takeAllocationStats();
+        MinMax::searchPosition(board, context, best);
+        stats.add(xoxo::takeAllocationStats());
+        nodes += context.nodes;
+    }
+
+    std::printf("alpha-beta, per node\n%s", stats.report(nodes).c_str());
+    return 0;
+}
+
+// the bench set searched by MCTS for iterations each and by alpha-beta for a hundred times as many nodes, one row.
+// no row when recorder is null, which only warms up the tables and the node pool
+static void printTraceRow(const char *recorder, int iterations) {
+    uint64_t used = 0;
+    double mctsSeconds = 0;
+    for (const char *fen : BENCH_FENS) {
+        chess::Board board(fen);
+        xoxo::MCTS mcts(&board);
+        auto begin = Clock::now();
+        used += mcts.search(iterations);
+        mctsSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+    }
+
+    uint64_t nodes = 0;
+    double alphaBetaSeconds = 0;
+    for (const char *fen : BENCH_FENS) {
+        xoxo::TranspositionTable::shared().clear();
+        xoxo::EvalCache::minmax().clear();
+        chess::Board board(fen);
+        MinMax::SearchContext context;
+        context.nodeLimit = static_cast<uint64_t>(iterations) * 100;
+        chess::Move best = chess::Move::NO_MOVE;
+        auto begin = Clock::now();
+        MinMax::searchPosition(board, context, best);
+        alphaBetaSeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+        nodes += context.nodes;
+    }
+
+    if (recorder != nullptr)
+        std::printf("%-10s %14.0f %14.0f\n", recorder, used / mctsSeconds, nodes / alphaBetaSeconds);
+}
+
+// compare both rows with those of a build without -DCHESS_TRACE=ON for the cost of having the recorder compiled in
+static int benchTrace(int iterations) {
+    printTraceRow(nullptr, iterations);
+
+    std::printf("%-10s %14s %14s\n", "recorder", "mcts it/s", "alpha-beta nps");
+    printTraceRow("off", iterations);
+
+#ifdef XOXO_TRACE
+    std::string path = (std::filesystem::temp_directory_path() / "chessbench.trace").string();
+    xoxo::TraceRecorder &recorder = xoxo::TraceRecorder::global();
+    if (!recorder.start(path)) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        return 1;
+    }
+
+    printTraceRow("on", iterations);
+
+    recorder.stop();
+    std::printf("%llu records written, %llu dropped\n", (unsigned long long)recorder.written(),
+                (unsigned long long)recorder.dropped());
+    std::filesystem::remove(path);
+#else
+    std::fprintf(stderr, "chess-bot was built without the trace recorder (-DCHESS_TRACE=ON), nothing to turn on\n");
+#endif
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    int iterations = 2000;
+    if (argc > 2 && !xoxo::parseNumber(argv[2], iterations)) {
+        usage();
+        return 1;
+    }
+
+    if (mode == "batch")
+        return benchBatch(iterations);
+    if (mode == "solver")
+        return benchSolver(iterations);
+    if (mode == "terminal")
+        return benchTerminal(iterations);
+    if (mode == "hybrid")
+        return benchHybrid(iterations);
+    if (mode == "stable")
+        return benchStable(iterations);
+    if (mode == "memory")
+        return benchMemory(iterations);
+    if (mode == "see")
+        return benchSee(iterations);
+    if (mode == "search")
+        return benchSearch(iterations);
+    if (mode == "halving")
+        return benchHalving(iterations);
+    if (mode == "dag")
+        return benchDag(iterations);
+    if (mode == "gc")
+        return benchGc(iterations);
+    if (mode == "counters")
+        return benchCounters(iterations);
+    if (mode == "alloc")
+        return benchAlloc(iterations);
+    if (mode == "trace")
+        return benchTrace(iterations);
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,163 @@
+#include "AllocationProfiler.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace xoxo {
+
+    //indexed by AllocTag
+    const char* ALLOC_TAG_NAMES[] = {"other", "mcts search", "mcts expand", "mcts simulate", "minmax", "mate solver"};
+
+    //trivially constructed, so touching it from operator new never runs an initializer that could allocate
+    thread_local AllocationStats localStats;
+
+    void AllocationStats::add(const AllocationStats& other)
+    {
+        allocations += other.allocations;
+        frees += other.frees;
+        bytes += other.bytes;
+
+        for(int i = 0; i < ALLOC_SIZE_CLASSES; i++)
+            sizeClasses[i] += other.sizeClasses[i];
+
+        for(int i = 0; i < ALLOC_TAG_COUNT; i++)
+        {
+            tagAllocations[i] += other.tagAllocations[i];
+            tagBytes[i] += other.tagBytes[i];
+        }
+    }
+
+    std::string AllocationStats::report(uint64_t nodes) const
+    {
+        std::string out;
+        char line[160];
+        double perNode = nodes > 0 ? 1.0 / nodes : 0.0;
+
+        std::snprintf(line, sizeof(line),
+                      "allocations %llu (%.2f per node), %.1f MB (%.0f bytes per node), %llu frees\n",
+                      (unsigned long long)allocations, allocations * perNode, bytes / (1024.0 * 1024.0),
+                      bytes * perNode, (unsigned long long)frees);
+        out += line;
+
+        for(int i = 0; i < ALLOC_TAG_COUNT; i++)
+        {
+            if(tagAllocations[i] == 0)
+                continue;
+
+            std::snprintf(line, sizeof(line), "  %-14s %12llu allocations %8.2f per node %10.1f MB\n",
+                          ALLOC_TAG_NAMES[i], (unsigned long long)tagAllocations[i], tagAllocations[i] * perNode,
+                          tagBytes[i] / (1024.0 * 1024.0));
+            out += line;
+        }
+
+        out += "  sizes";
+        for(int i = 0; i < ALLOC_SIZE_CLASSES; i++)
+        {
+            if(i + 1 < ALLOC_SIZE_CLASSES)
+                std::snprintf(line, sizeof(line), " <=%d:%llu", 16 << i, (unsigned long long)sizeClasses[i]);
+            else
+                std::snprintf(line, sizeof(line), " >%d:%llu", 16 << (i - 1), (unsigned long long)sizeClasses[i]);
+            out += line;
+        }
+
+        return out + "\n";
+    }
+
+    bool allocationProfiling()
+    {
+#ifdef XOXO_ALLOC_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    AllocationStats takeAllocationStats()
+    {
+        AllocationStats taken = localStats;
+        localStats = AllocationStats();
+        return taken;
+    }
+
+#ifdef XOXO_ALLOC_PROFILE
+    void countAllocation(std::size_t size)
+    {
+        int sizeClass = size <= 16 ? 0 : std::min(static_cast<int>(std::bit_width(size - 1)) - 4, ALLOC_SIZE_CLASSES - 1);
+        int tag = static_cast<int>(currentAllocTag);
+
+        localStats.allocations++;
+        localStats.bytes += size;
+        localStats.sizeClasses[sizeClass]++;
+        localStats.tagAllocations[tag]++;
+        localStats.tagBytes[tag] += size;
+    }
+
+    void* countedAllocate(std::size_t size)
+    {
+        countAllocation(size);
+        void* memory = std::malloc(size > 0 ? size : 1);
+        if(memory == nullptr)
+            throw std::bad_alloc();
+        return memory;
+    }
+
+    void* countedAllocate(std::size_t size, std::align_val_t alignment)
+    {
+        countAllocation(size);
+        std::size_t align = static_cast<std::size_t>(alignment);
+        //aligned_alloc wants a size that is a multiple of the alignment
+        void* memory = std::aligned_alloc(align, std::max(align, (size + align - 1) / align * align));
+        if(memory == nullptr)
+            throw std::bad_alloc();
+        return memory;
+    }
+
+    void countedFree(void* memory)
+    {
+        if(memory == nullptr)
+            return;
+
+        localStats.frees++;
+        std::free(memory);
+    }
+#endif
+
+} // xoxo
+
+#ifdef XOXO_ALLOC_PROFILE
+//every replaceable form forwards to the counting versions, the sized deletes do not need their size
+void* operator new(std::size_t size) { return xoxo::countedAllocate(size); }
+void* operator new[](std::size_t size) { return xoxo::countedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return xoxo::countedAllocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return xoxo::countedAllocate(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return xoxo::countedAllocate(size);
+    }
+    catch(const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept { xoxo::countedFree(memory); }
+void operator delete[](void* memory) noexcept { xoxo::countedFree(memory); }
+void operator delete(void* memory, std::size_t) noexcept { xoxo::countedFree(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { xoxo::countedFree(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { xoxo::countedFree(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { xoxo::countedFree(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { xoxo::countedFree(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { xoxo::countedFree(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { xoxo::countedFree(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { xoxo::countedFree(memory); }
+#endif
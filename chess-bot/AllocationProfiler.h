@@ -0,0 +1,70 @@
+#ifndef CHESS_ALLOCATIONPROFILER_H
+#define CHESS_ALLOCATIONPROFILER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace xoxo {
+
+    //the engine component an allocation is charged to, the innermost AllocScope decides
+    enum class AllocTag : uint8_t {
+        OTHER,
+        MCTS_SEARCH,
+        MCTS_EXPAND,
+        MCTS_SIMULATE,
+        MINMAX,
+        MATE_SOLVER,
+        COUNT
+    };
+
+    const int ALLOC_TAG_COUNT = static_cast<int>(AllocTag::COUNT);
+    //powers of two from 16 bytes up to 16KB, the last class holds everything bigger
+    const int ALLOC_SIZE_CLASSES = 12;
+
+    struct AllocationStats {
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+        uint64_t bytes = 0;
+        std::array<uint64_t, ALLOC_SIZE_CLASSES> sizeClasses{};
+        std::array<uint64_t, ALLOC_TAG_COUNT> tagAllocations{};
+        std::array<uint64_t, ALLOC_TAG_COUNT> tagBytes{};
+
+        void add(const AllocationStats& other);
+        //a few lines for benches and tools, per node figures when nodes is not 0
+        std::string report(uint64_t nodes) const;
+    };
+
+    //false unless chess-bot was built with XOXO_ALLOC_PROFILE (cmake -DCHESS_ALLOC_PROFILE=ON), which replaces the
+    //global new and delete with counting versions. without it every AllocationStats stays empty
+    bool allocationProfiling();
+
+    //what the calling thread allocated since the last call, and starts over
+    AllocationStats takeAllocationStats();
+
+#ifdef XOXO_ALLOC_PROFILE
+    inline thread_local AllocTag currentAllocTag = AllocTag::OTHER;
+
+    //charges the calling thread's allocations to tag until the scope ends
+    class AllocScope {
+    public:
+        explicit AllocScope(AllocTag tag) : previous(currentAllocTag) { currentAllocTag = tag; }
+        ~AllocScope() { currentAllocTag = previous; }
+        AllocScope(const AllocScope&) = delete;
+        AllocScope& operator=(const AllocScope&) = delete;
+
+    private:
+        AllocTag previous;
+    };
+#else
+    class AllocScope {
+    public:
+        explicit AllocScope(AllocTag) {}
+        AllocScope(const AllocScope&) = delete;
+        AllocScope& operator=(const AllocScope&) = delete;
+    };
+#endif
+
+} // xoxo
+
+#endif //CHESS_ALLOCATIONPROFILER_H
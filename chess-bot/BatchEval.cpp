@@ -0,0 +1,46 @@
+#include "BatchEval.h"
+#include "MinMax.h"
+#include "EvalTables.h"
+#include <cmath>
+
+namespace xoxo {
+
+    int BatchEvaluator::add(const chess::Board& board)
+    {
+        int lane = count++;
+
+        for(int type = 0; type < 6; type++)
+        {
+            chess::PieceType pieceType = static_cast<chess::PieceType::underlying>(type);
+            pieceCounts[type][lane] = board.pieces(pieceType, chess::Color::WHITE).count();
+            pieceCounts[type + 6][lane] = board.pieces(pieceType, chess::Color::BLACK).count();
+        }
+
+        //pawn structure is a hash probe per position and does not vectorize, so it is seeded here
+        scores[lane] = MinMax::getPawnStructure(board);
+
+        return lane;
+    }
+
+    void BatchEvaluator::evaluate()
+    {
+        //same weights as MinMax::getMaterialScore, the king is always on the board for both sides so it is skipped
+        for(int type = 0; type < 5; type++)
+        {
+            const int32_t value = materialValues[type];
+            const int32_t* white = pieceCounts[type];
+            const int32_t* black = pieceCounts[type + 6];
+
+            for(int lane = 0; lane < count; lane++)
+            {
+                scores[lane] += value * (white[lane] - black[lane]);
+            }
+        }
+    }
+
+    double scoreToWinProbability(int score)
+    {
+        return 1.0 / (1.0 + std::pow(10.0, -score / 400.0));
+    }
+
+} // xoxo
@@ -0,0 +1,37 @@
+#ifndef CHESS_BATCHEVAL_H
+#define CHESS_BATCHEVAL_H
+
+#include <cstdint>
+#include "chess.hpp"
+
+namespace xoxo {
+
+    const int MAX_EVAL_BATCH = 256;
+
+    //evaluates many positions at once. positions are gathered into piece count columns (one column per piece,
+    //one lane per position) so the material pass is a plain loop over lanes the compiler can vectorize
+    class BatchEvaluator {
+    public:
+        void clear() { count = 0; }
+        int size() const { return count; }
+        bool full() const { return count == MAX_EVAL_BATCH; }
+
+        //returns the lane the position was placed in
+        int add(const chess::Board& board);
+        void evaluate();
+
+        //white point of view, in centipawns
+        int score(int lane) const { return scores[lane]; }
+
+    private:
+        int count = 0;
+        alignas(64) int32_t pieceCounts[12][MAX_EVAL_BATCH];
+        alignas(64) int32_t scores[MAX_EVAL_BATCH];
+    };
+
+    //maps a centipawn score to a win probability in [0, 1]
+    double scoreToWinProbability(int score);
+
+} // xoxo
+
+#endif //CHESS_BATCHEVAL_H
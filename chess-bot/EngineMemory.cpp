@@ -0,0 +1,295 @@
+#include "EngineMemory.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define XOXO_HAS_MMAP 1
+#endif
+
+namespace xoxo {
+
+    const char* TAG_NAMES[] = {"transposition table", "eval cache", "pawn hash", "mcts nodes", "mate table"};
+
+    //alignment of the chunks and blocks that come from the heap
+    const std::align_val_t HEAP_ALIGNMENT{64};
+
+    EngineMemory::EngineMemory(uint64_t budget)
+    {
+        reserve(budget);
+    }
+
+    EngineMemory::~EngineMemory()
+    {
+        unmap();
+    }
+
+    bool EngineMemory::reserve(uint64_t budget)
+    {
+        std::lock_guard lock(mutex);
+
+        if(usedChunks != 0)
+            return false;
+
+        unmap();
+        budgetChunks = budget / MEMORY_CHUNK;
+        reservedChunks = std::min(RESERVED_CHUNKS, budgetChunks / 4);
+
+        if(budgetChunks == 0)
+            return true;
+
+#ifdef XOXO_HAS_MMAP
+        //one spare chunk to line the start up on a huge page boundary. nothing is committed until it is touched
+        uint64_t size = (budgetChunks + 1) * MEMORY_CHUNK;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE;
+#endif
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+        if(memory != MAP_FAILED)
+        {
+            mapping = memory;
+            mappingSize = size;
+            uintptr_t address = reinterpret_cast<uintptr_t>(memory);
+            base = reinterpret_cast<char*>((address + MEMORY_CHUNK - 1) & ~(MEMORY_CHUNK - 1));
+            chunks.assign(budgetChunks, false);
+#ifdef MADV_HUGEPAGE
+            hugePagesEnabled = madvise(base, budgetChunks * MEMORY_CHUNK, MADV_HUGEPAGE) == 0;
+#endif
+        }
+#endif
+
+        //no mapping: chunks come from the heap one allocation at a time, the budget only caps how many
+        return true;
+    }
+
+    void EngineMemory::unmap()
+    {
+#ifdef XOXO_HAS_MMAP
+        if(mapping != nullptr)
+            munmap(mapping, mappingSize);
+#endif
+
+        mapping = nullptr;
+        mappingSize = 0;
+        base = nullptr;
+        hugePagesEnabled = false;
+        budgetChunks = 0;
+        reservedChunks = 0;
+        chunks.clear();
+    }
+
+    char* EngineMemory::takeChunks(uint64_t count, bool reserved)
+    {
+        if(usedChunks + count > budgetChunks - (reserved ? 0 : reservedChunks))
+            return nullptr;
+
+        char* memory = nullptr;
+
+        if(base != nullptr)
+        {
+            //first fit, allocations are few and large so a linear scan is plenty
+            uint64_t run = 0;
+            for(uint64_t i = 0; i < chunks.size() && memory == nullptr; i++)
+            {
+                run = chunks[i] ? 0 : run + 1;
+
+                if(run == count)
+                {
+                    uint64_t first = i + 1 - count;
+                    for(uint64_t c = first; c <= i; c++)
+                        chunks[c] = true;
+
+                    memory = base + first * MEMORY_CHUNK;
+                }
+            }
+        }
+        else
+        {
+            memory = static_cast<char*>(::operator new(count * MEMORY_CHUNK, HEAP_ALIGNMENT, std::nothrow));
+        }
+
+        if(memory == nullptr)
+            return nullptr;
+
+        usedChunks += count;
+        peakChunks = std::max(peakChunks, usedChunks);
+        return memory;
+    }
+
+    void EngineMemory::returnChunks(char* memory, uint64_t count)
+    {
+        if(base != nullptr)
+        {
+            uint64_t first = (memory - base) / MEMORY_CHUNK;
+            for(uint64_t c = first; c < first + count; c++)
+                chunks[c] = false;
+        }
+        else
+        {
+            ::operator delete(memory, HEAP_ALIGNMENT);
+        }
+
+        usedChunks -= count;
+    }
+
+    char* EngineMemory::takeBlock(uint64_t bytes, bool reserved)
+    {
+        uint64_t size = std::max(MEMORY_BLOCK, std::bit_ceil(bytes));
+        uint64_t blocks = MEMORY_CHUNK / size;
+        uint64_t full = blocks == 64 ? ~0ULL : (1ULL << blocks) - 1;
+
+        for(BlockChunk& chunk : blockChunks)
+        {
+            if(chunk.blockSize != size || chunk.used == full)
+                continue;
+
+            int index = std::countr_one(chunk.used);
+            chunk.used |= 1ULL << index;
+            return chunk.memory + index * size;
+        }
+
+        char* memory = takeChunks(1, reserved);
+        if(memory != nullptr)
+            blockChunks.push_back({memory, size, 1});
+
+        return memory;
+    }
+
+    void EngineMemory::returnBlock(char* memory)
+    {
+        for(size_t i = 0; i < blockChunks.size(); i++)
+        {
+            BlockChunk& chunk = blockChunks[i];
+            if(memory < chunk.memory || memory >= chunk.memory + MEMORY_CHUNK)
+                continue;
+
+            chunk.used &= ~(1ULL << ((memory - chunk.memory) / chunk.blockSize));
+
+            if(chunk.used == 0)
+            {
+                returnChunks(chunk.memory, 1);
+                blockChunks.erase(blockChunks.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+
+            return;
+        }
+    }
+
+    void* EngineMemory::allocate(uint64_t bytes, MemoryTag tag)
+    {
+        return allocate(bytes, tag, false);
+    }
+
+    void* EngineMemory::allocateReserved(uint64_t bytes, MemoryTag tag)
+    {
+        return allocate(bytes, tag, true);
+    }
+
+    void* EngineMemory::allocate(uint64_t bytes, MemoryTag tag, bool reserved)
+    {
+        std::lock_guard lock(mutex);
+
+        uint64_t size;
+        char* memory;
+
+        if(bytes <= MEMORY_CHUNK / 2)
+        {
+            size = std::max(MEMORY_BLOCK, std::bit_ceil(bytes));
+            memory = takeBlock(bytes, reserved);
+        }
+        else
+        {
+            size = (bytes + MEMORY_CHUNK - 1) / MEMORY_CHUNK * MEMORY_CHUNK;
+            memory = takeChunks(size / MEMORY_CHUNK, reserved);
+        }
+
+        if(memory == nullptr)
+            return nullptr;
+
+        tagBytes[static_cast<size_t>(tag)] += size;
+        std::memset(memory, 0, size);
+        return memory;
+    }
+
+    void* EngineMemory::allocateUpTo(uint64_t& bytes, uint64_t minimum, MemoryTag tag)
+    {
+        for(; bytes >= minimum && bytes > 0; bytes /= 2)
+        {
+            if(void* memory = allocate(bytes, tag))
+                return memory;
+        }
+
+        return nullptr;
+    }
+
+    void EngineMemory::release(void* memory, uint64_t bytes, MemoryTag tag)
+    {
+        if(memory == nullptr)
+            return;
+
+        std::lock_guard lock(mutex);
+
+        if(bytes <= MEMORY_CHUNK / 2)
+        {
+            returnBlock(static_cast<char*>(memory));
+            tagBytes[static_cast<size_t>(tag)] -= std::max(MEMORY_BLOCK, std::bit_ceil(bytes));
+            return;
+        }
+
+        uint64_t count = (bytes + MEMORY_CHUNK - 1) / MEMORY_CHUNK;
+        returnChunks(static_cast<char*>(memory), count);
+        tagBytes[static_cast<size_t>(tag)] -= count * MEMORY_CHUNK;
+    }
+
+    uint64_t EngineMemory::used() const
+    {
+        std::lock_guard lock(mutex);
+        return usedChunks * MEMORY_CHUNK;
+    }
+
+    uint64_t EngineMemory::used(MemoryTag tag) const
+    {
+        std::lock_guard lock(mutex);
+        return tagBytes[static_cast<size_t>(tag)];
+    }
+
+    uint64_t EngineMemory::peak() const
+    {
+        std::lock_guard lock(mutex);
+        return peakChunks * MEMORY_CHUNK;
+    }
+
+    std::string EngineMemory::report() const
+    {
+        std::lock_guard lock(mutex);
+        const double mb = 1024.0 * 1024.0;
+        char line[128];
+        std::string text;
+
+        std::snprintf(line, sizeof(line), "engine memory: %.0f/%.0f MB used, %.0f MB peak, %.0f MB held back, %s\n",
+                      usedChunks * MEMORY_CHUNK / mb, budgetChunks * MEMORY_CHUNK / mb, peakChunks * MEMORY_CHUNK / mb,
+                      reservedChunks * MEMORY_CHUNK / mb,
+                      base == nullptr ? "heap" : hugePagesEnabled ? "huge pages" : "normal pages");
+        text += line;
+
+        for(size_t tag = 0; tag < tagBytes.size(); tag++)
+        {
+            std::snprintf(line, sizeof(line), "  %-20s %8.0f MB\n", TAG_NAMES[tag], tagBytes[tag] / mb);
+            text += line;
+        }
+
+        return text;
+    }
+
+    EngineMemory& EngineMemory::global()
+    {
+        static EngineMemory memory;
+        return memory;
+    }
+
+} // xoxo
@@ -0,0 +1,105 @@
+#ifndef CHESS_ENGINEMEMORY_H
+#define CHESS_ENGINEMEMORY_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xoxo {
+
+    //the tournament allows 16GB, leave room for the boards every node still keeps on the heap
+    const uint64_t DEFAULT_ENGINE_MEMORY = 4ULL << 30;
+    //allocation granularity, one huge page
+    const uint64_t MEMORY_CHUNK = 2ULL << 20;
+    //requests up to half a chunk share chunks, in power of two blocks no smaller than this
+    const uint64_t MEMORY_BLOCK = MEMORY_CHUNK / 64;
+    //chunks held back for allocateReserved, at most a quarter of the budget
+    const uint64_t RESERVED_CHUNKS = 8;
+
+    enum class MemoryTag : uint8_t {
+        TRANSPOSITION_TABLE,
+        EVAL_CACHE,
+        PAWN_HASH,
+        MCTS_NODES,
+        MATE_TABLE,
+        COUNT
+    };
+
+    //one reservation for every big engine structure. the budget is mapped up front (huge pages when the kernel
+    //allows it, plain pages otherwise) and handed out in whole chunks, so the engine never grows past it: an
+    //allocation that does not fit returns nullptr instead. where nothing can be mapped (wasm, windows) the budget
+    //is only counted and every chunk comes from the heap when it is asked for. a few chunks of the budget are held
+    //back for allocateReserved, so the first node slab and the tables still fit once the big tables took the rest
+    class EngineMemory {
+    public:
+        explicit EngineMemory(uint64_t budget = DEFAULT_ENGINE_MEMORY);
+        ~EngineMemory();
+        EngineMemory(const EngineMemory&) = delete;
+        EngineMemory& operator=(const EngineMemory&) = delete;
+
+        //replaces the reservation, only possible while nothing is allocated from it
+        bool reserve(uint64_t budget);
+
+        //zero filled memory, nullptr when it would go over the budget. whole chunks are aligned to MEMORY_CHUNK
+        //when the budget is mapped and to a cache line otherwise, smaller requests get a block of a shared chunk
+        void* allocate(uint64_t bytes, MemoryTag tag);
+        //halves bytes down to minimum until the allocation fits, bytes holds what was actually allocated
+        void* allocateUpTo(uint64_t& bytes, uint64_t minimum, MemoryTag tag);
+        //allocate, allowed into the chunks held back for what a search cannot start without. still nullptr past the
+        //budget
+        void* allocateReserved(uint64_t bytes, MemoryTag tag);
+        //bytes must be what allocate was asked for
+        void release(void* memory, uint64_t bytes, MemoryTag tag);
+
+        uint64_t budget() const { return budgetChunks * MEMORY_CHUNK; }
+        uint64_t used() const;
+        uint64_t used(MemoryTag tag) const;
+        uint64_t peak() const;
+        bool hugePages() const { return hugePagesEnabled; }
+        //one line per tag, for benches and logs
+        std::string report() const;
+
+        //call global().reserve(bytes) before the first search to choose the budget
+        static EngineMemory& global();
+
+    private:
+        //a chunk cut into blocks of one size, for requests up to half a chunk
+        struct BlockChunk {
+            char* memory;
+            uint64_t blockSize;
+            //bit per block, set for blocks in use
+            uint64_t used;
+        };
+
+        void unmap();
+        void* allocate(uint64_t bytes, MemoryTag tag, bool reserved);
+        //count contiguous chunks out of the budget, nullptr when they do not fit. only reserved allocations may
+        //take the held back chunks
+        char* takeChunks(uint64_t count, bool reserved);
+        void returnChunks(char* memory, uint64_t count);
+        char* takeBlock(uint64_t bytes, bool reserved);
+        void returnBlock(char* memory);
+
+        //the mapping as returned by the system, base is its first chunk aligned address. both stay null when
+        //nothing could be mapped
+        void* mapping = nullptr;
+        uint64_t mappingSize = 0;
+        char* base = nullptr;
+        bool hugePagesEnabled = false;
+
+        mutable std::mutex mutex;
+        uint64_t budgetChunks = 0;
+        uint64_t reservedChunks = 0;
+        //true for chunks of the mapping in use
+        std::vector<bool> chunks;
+        std::vector<BlockChunk> blockChunks;
+        uint64_t usedChunks = 0;
+        uint64_t peakChunks = 0;
+        std::array<uint64_t, static_cast<size_t>(MemoryTag::COUNT)> tagBytes = {};
+    };
+
+} // xoxo
+
+#endif //CHESS_ENGINEMEMORY_H
@@ -0,0 +1,138 @@
+#include "EvalCache.h"
+#include "EngineMemory.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+
+namespace xoxo {
+
+    const uint64_t KEY_MASK = 0xFFFFFFFF00000000ULL;
+
+    EvalCache::EvalCache(uint64_t entries)
+    {
+        resize(entries);
+    }
+
+    EvalCache::~EvalCache()
+    {
+        if(table != &fallback)
+            EngineMemory::global().release(table, size() * sizeof(uint64_t), MemoryTag::EVAL_CACHE);
+    }
+
+    bool EvalCache::probe(uint64_t key, int& score)
+    {
+        uint64_t entry = table[key & mask].load(std::memory_order_relaxed);
+
+        //an empty slot is all zeros, which only a key with a zero upper half could match
+        if(entry != 0 && (entry & KEY_MASK) == (key & KEY_MASK))
+        {
+            score = static_cast<int32_t>(static_cast<uint32_t>(entry));
+            counters().hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        counters().misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void EvalCache::store(uint64_t key, int score)
+    {
+        uint64_t entry = (key & KEY_MASK) | static_cast<uint32_t>(score);
+        table[key & mask].store(entry, std::memory_order_relaxed);
+    }
+
+    void EvalCache::forget(uint64_t key)
+    {
+        table[key & mask].store(0, std::memory_order_relaxed);
+    }
+
+    void EvalCache::resize(uint64_t entries)
+    {
+        EngineMemory& memory = EngineMemory::global();
+        if(table != nullptr && table != &fallback)
+            memory.release(table, size() * sizeof(uint64_t), MemoryTag::EVAL_CACHE);
+        table = nullptr;
+
+        uint64_t wanted = std::bit_floor(entries > 0 ? entries : 1) * sizeof(uint64_t);
+        uint64_t bytes = wanted;
+        void* block = memory.allocateUpTo(bytes, sizeof(uint64_t), MemoryTag::EVAL_CACHE);
+
+        //nothing left of the budget, a chunk of what is held back keeps the searches running
+        if(block == nullptr)
+        {
+            bytes = std::min(wanted, MEMORY_CHUNK);
+            block = memory.allocateReserved(bytes, MemoryTag::EVAL_CACHE);
+        }
+
+        //not even that, a single slot still caches the last evaluation
+        if(block == nullptr)
+        {
+            table = &fallback;
+            mask = 0;
+            clear();
+            return;
+        }
+
+        uint64_t size = bytes / sizeof(uint64_t);
+        table = static_cast<std::atomic<uint64_t>*>(block);
+        std::uninitialized_value_construct_n(table, size);
+        mask = size - 1;
+        clear();
+    }
+
+    void EvalCache::clear()
+    {
+        for(uint64_t i = 0; i <= mask; i++)
+            table[i].store(0, std::memory_order_relaxed);
+
+        for(Counters& stripe : stripes)
+        {
+            stripe.hits.store(0, std::memory_order_relaxed);
+            stripe.misses.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    EvalCache::Counters& EvalCache::counters()
+    {
+        //threads take stripes in the order they first probe any cache
+        static std::atomic<int> nextStripe{0};
+        static thread_local int stripe =
+            nextStripe.fetch_add(1, std::memory_order_relaxed) % EVAL_CACHE_COUNTER_STRIPES;
+        return stripes[stripe];
+    }
+
+    uint64_t EvalCache::hits() const
+    {
+        uint64_t total = 0;
+        for(const Counters& stripe : stripes)
+            total += stripe.hits.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint64_t EvalCache::misses() const
+    {
+        uint64_t total = 0;
+        for(const Counters& stripe : stripes)
+            total += stripe.misses.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    double EvalCache::hitRate() const
+    {
+        uint64_t total = hits() + misses();
+        return total == 0 ? 0.0 : static_cast<double>(hits()) / total;
+    }
+
+    EvalCache& EvalCache::minmax()
+    {
+        static EvalCache cache;
+        return cache;
+    }
+
+    EvalCache& EvalCache::mcts()
+    {
+        static EvalCache cache;
+        return cache;
+    }
+
+} // xoxo
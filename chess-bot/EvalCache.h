@@ -0,0 +1,61 @@
+#ifndef CHESS_EVALCACHE_H
+#define CHESS_EVALCACHE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace xoxo {
+
+    const uint64_t DEFAULT_EVAL_CACHE_ENTRIES = 1 << 20;
+    //hit and miss counters, each thread counts on its own cache line unless there are more threads than this
+    const int EVAL_CACHE_COUNTER_STRIPES = 16;
+
+    //zobrist keyed cache of static evaluations shared by every thread in the process.
+    //each slot is a single 64 bit word: the upper half of the key to verify the hit and the score in the lower half,
+    //so a read can never see half of one entry and half of another and no locking is needed
+    class EvalCache {
+    public:
+        explicit EvalCache(uint64_t entries = DEFAULT_EVAL_CACHE_ENTRIES);
+        ~EvalCache();
+        EvalCache(const EvalCache&) = delete;
+        EvalCache& operator=(const EvalCache&) = delete;
+
+        bool probe(uint64_t key, int& score);
+        void store(uint64_t key, int score);
+        //empties the slot of key so the next probe for it misses
+        void forget(uint64_t key);
+
+        //not safe while a search is running, shrinks to what is left of the engine memory budget, to a chunk of the
+        //memory held back when nothing is, and to a single slot without even that
+        void resize(uint64_t entries);
+        void clear();
+
+        uint64_t size() const { return mask + 1; }
+        uint64_t hits() const;
+        uint64_t misses() const;
+        double hitRate() const;
+
+        //one cache per evaluator, their scores are not interchangeable
+        static EvalCache& minmax();
+        static EvalCache& mcts();
+
+    private:
+        std::atomic<uint64_t>* table = nullptr;
+        uint64_t mask = 0;
+        //the table when the budget has no room for one
+        std::atomic<uint64_t> fallback{0};
+
+        struct alignas(64) Counters {
+            std::atomic<uint64_t> hits{0};
+            std::atomic<uint64_t> misses{0};
+        };
+
+        //the stripe of the calling thread
+        Counters& counters();
+
+        Counters stripes[EVAL_CACHE_COUNTER_STRIPES];
+    };
+
+} // xoxo
+
+#endif //CHESS_EVALCACHE_H
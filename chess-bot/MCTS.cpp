@@ -3,12 +3,45 @@
 //
 
 #include "MCTS.h"
+#include "EvalCache.h"
+#include "BatchEval.h"
+#include "EvalTables.h"
+#include "MinMax.h"
+#include "SEE.h"
+#include "Params.h"
+#include "SearchTrace.h"
+#include "PerfCounters.h"
+#include "AllocationProfiler.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
 
 namespace xoxo {
 
-    const double RAVE_FACTOR = 0.75;
     const double EPSILON = 0.00000001;
 
+    //rave, exploration and draw constants live in the Params registry
+    //prior logits: per pawn of static exchange gain, for giving check, for a saturated history entry and per pawn
+    //of piece-square gain
+    const double PRIOR_SEE_WEIGHT = 0.5;
+    const double PRIOR_CHECK_WEIGHT = 1.0;
+    const double PRIOR_HISTORY_WEIGHT = 1.0;
+    const double PRIOR_PST_WEIGHT = 1.0;
+    //history count at which an entry is worth half its weight
+    const double HISTORY_SCALE = 32.0;
+
+    //sigma(q) = (c_visit + max visits) * c_scale * q from the gumbel muzero paper, with its constants
+    const double GUMBEL_VISIT_OFFSET = 50.0;
+    const double GUMBEL_VALUE_SCALE = 1.0;
+
+    //iterations between looks at the control block and the clock, a batched round always looks
+    const int CONTROL_POLL_INTERVAL = 64;
+    const std::chrono::milliseconds SNAPSHOT_INTERVAL(50);
+
     int getMaterialScore(const chess::Board& board)
     {
         int materialScore = 0;
@@ -19,20 +52,13 @@ namespace xoxo {
         materialScore += 99999 * (board.pieces(chess::PieceType::KING, ourSide).count() -
                 board.pieces(chess::PieceType::KING, theirSide).count());
 
-        materialScore += 900 * (board.pieces(chess::PieceType::QUEEN, ourSide).count() -
-                board.pieces(chess::PieceType::QUEEN, theirSide).count());
-
-        materialScore += 500 * (board.pieces(chess::PieceType::ROOK, ourSide).count() -
-                board.pieces(chess::PieceType::ROOK, theirSide).count());
-
-        materialScore += 330 * (board.pieces(chess::PieceType::BISHOP, ourSide).count() -
-                board.pieces(chess::PieceType::BISHOP, theirSide).count());
-
-        materialScore += 320 * (board.pieces(chess::PieceType::KNIGHT, ourSide).count() -
-                board.pieces(chess::PieceType::KNIGHT, theirSide).count());
-
-        materialScore += 100 * (board.pieces(chess::PieceType::PAWN, ourSide).count() -
-                board.pieces(chess::PieceType::PAWN, theirSide).count());
+        //the same weights as the alpha-beta evaluation, so tuned values reach the playouts too
+        for(int type = 0; type < 5; type++)
+        {
+            chess::PieceType pieceType = static_cast<chess::PieceType::underlying>(type);
+            materialScore += materialValues[type] * (board.pieces(pieceType, ourSide).count() -
+                    board.pieces(pieceType, theirSide).count());
+        }
 
         return materialScore;
     }
@@ -82,79 +108,230 @@ namespace xoxo {
 
     int getBoardScore(chess::Board& board)
     {
-        if(board.isGameOver().first == chess::GameResultReason::CHECKMATE)
+        PerfScope scope(PerfPhase::EVAL);
+
+        int score;
+        if(EvalCache::mcts().probe(board.hash(), score))
+            return score;
+
+        if(isCheckmate(board))
         {
-            return 10000;
+            score = 10000;
         }
-        //determining the score of the board based on materials
-        int materialScore = getMaterialScore(board);
-        //int mobilityScore = getMobilityScore(board);
-        //5.compare pawn structure
-        int kingSafety = getKingSafety(board) * 10;
+        else
+        {
+            //determining the score of the board based on materials
+            int materialScore = getMaterialScore(board);
+            //int mobilityScore = getMobilityScore(board);
+            //5.compare pawn structure
+            int kingSafety = getKingSafety(board) * 10;
 
+            score = kingSafety + materialScore;//materialScore;// + mobilityScore;// + kingSafety;
+        }
 
-        return kingSafety + materialScore;//materialScore;// + mobilityScore;// + kingSafety;
+        EvalCache::mcts().store(board.hash(), score);
+        return score;
     }
 
 
-    Node* Node::selectChild()
+    Node* Node::selectChild(SelectionPolicy policy)
+    {
+        int edge = selectEdge(policy);
+        return edge >= 0 ? children[edge] : nullptr;
+    }
+
+    int Node::selectEdge(SelectionPolicy policy)
     {
         double best_score = -1.0;
-        Node* best_child = nullptr;
+        int best_edge = -1;
+        bool ourTurn = board.sideToMove() == us;
+        //a child proven lost for the player choosing here is never worth another visit
+        Proof losing = ourTurn ? Proof::LOSS : Proof::WIN;
 
-        for(Node* child : children)
+        //unvisited children start from this node's value for the player choosing
+        double nodeValue = visits > 0 ? wins / visits : 0.5;
+        double firstPlayValue = ourTurn ? nodeValue : 1.0 - nodeValue;
+        double sqrtVisits = sqrt(static_cast<double>(visits + virtualLoss));
+        const ParamSet& params = activeParams();
+        const double puctExploration = params[Param::PUCT_EXPLORATION];
+        const double ucbExploration = params[Param::UCB_EXPLORATION];
+        const double raveEquivalence = params[Param::RAVE_EQUIVALENCE];
+        const double logVisits = log(static_cast<double>(visits + virtualLoss));
+
+        //the value of a move is its child's, shared by every edge leading there, while exploration is counted per
+        //edge: a move tried once from here is still barely explored, however often its position was visited by
+        //other move orders. in a tree both counts are the same
+        for(size_t i = 0; i < children.size(); i++)
         {
-            double exploitation_term = static_cast<double>(child->wins) / (child->visits + 0.000001f);
-            double exploration_term = 2.0 * sqrt(log(static_cast<double>(visits)) / (child->visits + 0.000001f));
+            Node* child = children[i];
+            const Edge& edge = edges[i];
+
+            if(child->proof == losing)
+                continue;
+
+            double score;
+
+            if(policy == SelectionPolicy::PUCT)
+            {
+                //virtual losses count as visits the player choosing did not win
+                int childVisits = child->visits + child->virtualLoss;
+                double chooserWins = ourTurn ? child->wins : child->visits - child->wins;
+                double value = childVisits > 0 ? chooserWins / childVisits : firstPlayValue;
+
+                score = value + puctExploration * edge.prior * sqrtVisits / (1 + edge.visits + child->virtualLoss);
+            }
+            else
+            {
+                double childVisits = child->visits + child->virtualLoss + 0.000001f;
+                double edgeVisits = edge.visits + child->virtualLoss + 0.000001f;
+                double chooserWins = ourTurn ? child->wins : child->visits - child->wins;
+                double exploitation_term = chooserWins / childVisits;
+
+                //rave: the amaf value is available after a handful of simulations but biased, so it is trusted less
+                //as the move's own visits grow, beta = sqrt(k / (3n + k))
+                if(edge.amafVisits > 0)
+                {
+                    double amafWins = ourTurn ? edge.amafWins : edge.amafVisits - edge.amafWins;
+                    double beta = sqrt(raveEquivalence / (3.0 * edge.visits + raveEquivalence));
+                    exploitation_term = (1 - beta) * exploitation_term + beta * amafWins / edge.amafVisits;
+                }
+
+                double exploration_term = ucbExploration * sqrt(logVisits / edgeVisits);
 
-            double score = exploitation_term + getRaveScore()+ exploration_term;
+                score = exploitation_term + exploration_term;
+            }
 
             if(score > best_score)
             {
-                best_child = child;
+                best_edge = static_cast<int>(i);
                 best_score = score;
             }
         }
 
-        return best_child;
+        //every move loses, the node itself is proven and is only reached from the root
+        if(best_edge < 0 && !children.empty())
+            return 0;
+
+        return best_edge;
     }
 
-    void Node::expand()
+    bool Node::expand(NodePool& pool, NodeTable* table)
     {
+        if(pool.releases() < expansionRetry)
+            return false;
+
         chess::Movelist moves;
         chess::movegen::legalmoves(moves, board);
 
+        if(moves.empty() && board.inCheck())
+        {
+            proof = board.sideToMove() == us ? Proof::LOSS : Proof::WIN;
+            return true;
+        }
+
+        children.reserve(moves.size());
+        edges.reserve(moves.size());
+        uint64_t merged = 0;
+        //children made by this call, by index. only these are undone when the pool runs out, a merged child belongs
+        //to whoever created it
+        std::bitset<256> created;
+
         for (chess::Move move : moves) {
             chess::Board tempBoard(board);
             tempBoard.makeMove(move);
 
-            Node* child = new Node(tempBoard, &move, this, us);
+            Node* child = nullptr;
+
+            if(table != nullptr)
+            {
+                auto found = table->nodes.find(tempBoard.hash());
+                if(found != table->nodes.end())
+                {
+                    child = found->second;
+                    merged++;
+                }
+            }
+
+            if(child == nullptr)
+            {
+                child = pool.create(tempBoard, &move, this, us);
+
+                //out of budget, stay a leaf rather than a half expanded node
+                if(child == nullptr)
+                {
+                    for(size_t i = 0; i < children.size(); i++)
+                    {
+                        if(!created.test(i))
+                            continue;
+
+                        if(table != nullptr)
+                            table->nodes.erase(children[i]->board.hash());
+                        pool.destroy(children[i]);
+                    }
+
+                    children.clear();
+                    edges.clear();
+                    expansionRetry = pool.releases() + 1;
+                    return false;
+                }
+
+                if(table != nullptr)
+                    table->nodes.emplace(tempBoard.hash(), child);
+                created.set(children.size());
+            }
+
             children.push_back(child);
+            edges.push_back({move});
         }
+
+        for(Node* child : children)
+            child->references++;
+
+        XOXO_TRACE_EVENT(TraceEvent::EXPAND, board.hash(), move.move(), 0, 0, static_cast<uint32_t>(children.size()));
+
+        if(table != nullptr)
+        {
+            table->edges += children.size();
+            table->mergedEdges += merged;
+        }
+
+        return true;
     }
 
-    int Node::simulate()
+    double Node::simulate(RepetitionStack& repetitions, std::vector<chess::Move>* played)
     {
         chess::Board tempBoard(board);
 
         do
         {
             chess::Movelist moves;
-            chess::movegen::legalmoves(moves, tempBoard);
+            {
+                PerfScope scope(PerfPhase::MOVEGEN);
+                chess::movegen::legalmoves(moves, tempBoard);
+            }
 
+            Terminal terminal = getTerminal(tempBoard, moves, &repetitions);
 
-            if(tempBoard.isGameOver().first == chess::GameResultReason::CHECKMATE)
+            if(terminal == Terminal::CHECKMATE)
             {
                 auto color = tempBoard.sideToMove();
-                return (color == us) ? -1 : 1;
+                return (color == us) ? -1.0 : 1.0;
             }
-            else if(tempBoard.isGameOver().first != chess::GameResultReason::NONE)
+            else if(terminal != Terminal::NONE)
             {
-                return DEFAULT_VALUE;
+                return param(Param::DEFAULT_VALUE);
             }
 
-            for(chess::Move& move : moves)
+            //captures that lose the exchange go to the back and are only played when nothing else is left
+            auto playable = std::partition(moves.begin(), moves.end(), [&tempBoard](const chess::Move& move)
+                { return !tempBoard.isCapture(move) || seeAtLeast(tempBoard, move, 0); });
+
+            if(playable == moves.begin())
+                playable = moves.end();
+
+            for(auto it = moves.begin(); it != playable; ++it)
             {
+                chess::Move& move = *it;
                 tempBoard.makeMove(move);
                 auto uciString = chess::uci::moveToUci(move);
                 int boardEval = getBoardScore(tempBoard);
@@ -162,95 +339,854 @@ namespace xoxo {
                 tempBoard.unmakeMove(move);
             }
 
-            std::sort(moves.begin(), moves.end(), [](const chess::Move& a, const chess::Move& b)
+            std::sort(moves.begin(), playable, [](const chess::Move& a, const chess::Move& b)
                 { return a.score() > b.score(); });
 
             //move->setScore(moves[0].score());
+            repetitions.push(tempBoard.hash());
             tempBoard.makeMove(moves[0]);
 
+            if(played != nullptr)
+                played->push_back(moves[0]);
+
         } while (true);
     }
 
-    void Node::backPropagate(int result)
+    bool Node::updateProof()
     {
-        Node* node = this;
-        while(node != nullptr)
+        if(proof != Proof::UNKNOWN || children.empty())
+            return false;
+
+        //the player to move picks the best child: one winning child decides the node, and it is only lost when
+        //every child is lost
+        bool ourTurn = board.sideToMove() == us;
+        Proof best = ourTurn ? Proof::WIN : Proof::LOSS;
+        Proof worst = ourTurn ? Proof::LOSS : Proof::WIN;
+        bool allWorst = true;
+
+        for(Node* child : children)
         {
-            node->visits++;
-            if(result > 0)
-                node->wins++;
+            if(child->proof == best)
+            {
+                proof = best;
+                return true;
+            }
 
-            node = node->parent;
+            if(child->proof != worst)
+                allWorst = false;
         }
-    }
-
-    double Node::getRaveScore() const
-    {
-        if(parent == nullptr) return 0;
 
-        double winRate = static_cast<double>(wins) / (visits + EPSILON);
-        double parentWinRate = static_cast<double>(parent->wins) / (parent->visits + EPSILON);
+        if(allWorst)
+        {
+            proof = worst;
+            return true;
+        }
 
-        return ((RAVE_FACTOR * winRate) + ((1 - RAVE_FACTOR) * parentWinRate)) / (parent->visits + EPSILON);
+        return false;
     }
 
-    Node::Node(chess::Board b, chess::Move *m, Node *p, chess::Color c){
+    Node::Node(chess::Board b, const chess::Move *m, Node *p, chess::Color c){
         board = (std::move(b));
         us = (c);
-        move = (m);
+        move = m != nullptr ? *m : chess::Move(chess::Move::NO_MOVE);
         parent = (p);
         visits = (0);
         wins = (0);
 
-        if(move != nullptr)
-            uciString = (chess::uci::moveToUci(*move));
+        if(m != nullptr)
+            uciString = (chess::uci::moveToUci(*m));
+    }
+
+    NodePool::~NodePool() {
+        for(void* slab : slabs)
+            EngineMemory::global().release(slab, MEMORY_CHUNK, MemoryTag::MCTS_NODES);
+    }
+
+    Node* NodePool::create(const chess::Board& board, const chess::Move* move, Node* parent, chess::Color us) {
+        void* slot = freeList;
+
+        if(slot != nullptr)
+        {
+            freeList = *static_cast<void**>(slot);
+        }
+        else
+        {
+            if(cursor == nullptr || slabEnd - cursor < static_cast<std::ptrdiff_t>(sizeof(Node)))
+            {
+                EngineMemory& memory = EngineMemory::global();
+                void* slab = slabs.empty() ? memory.allocateReserved(MEMORY_CHUNK, MemoryTag::MCTS_NODES)
+                                           : memory.allocate(MEMORY_CHUNK, MemoryTag::MCTS_NODES);
+                if(slab == nullptr)
+                    return nullptr;
+
+                slabs.push_back(slab);
+                cursor = static_cast<char*>(slab);
+                slabEnd = cursor + MEMORY_CHUNK;
+            }
+
+            slot = cursor;
+            cursor += sizeof(Node);
+        }
+
+        liveNodes++;
+        return new (slot) Node(board, move, parent, us);
+    }
+
+    void NodePool::destroy(Node* node) {
+        for(Node* child : node->children)
+        {
+            if(child->parent == node)
+                destroy(child);
+        }
+
+        release(node);
+    }
+
+    void NodePool::release(Node* node) {
+        node->~Node();
+        *reinterpret_cast<void**>(node) = freeList;
+        freeList = node;
+        liveNodes--;
+        releasedNodes++;
+    }
+
+    int MCTS::search(int iterations) {
+        if(rootPolicy == RootPolicy::SEQUENTIAL_HALVING)
+            return searchSequentialHalving(iterations);
+
+        searchStart = std::chrono::steady_clock::now();
+        XOXO_TRACE_EVENT(TraceEvent::SEARCH_BEGIN, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(iterations));
+        AllocScope allocations(AllocTag::MCTS_SEARCH);
+        lastPublish = searchStart;
+        rootChoice = -1;
+        NodeTable* nodeTable = useTable();
+
+        int i = 0;
+        for(; i < iterations && root->proof == Proof::UNKNOWN; i++)
+        {
+            if(i % CONTROL_POLL_INTERVAL == 0 && pollControl(i))
+                break;
+
+            collectIfNeeded();
+            selectNode();
+            evaluateSelection(nodeTable);
+        }
+
+        if(control != nullptr)
+            publishSnapshot(i, true);
+
+        XOXO_TRACE_EVENT(TraceEvent::SEARCH_END, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(i));
+        return i;
+    }
+
+    void MCTS::evaluateSelection(NodeTable* nodeTable) {
+        Node* node = path.leaf();
+
+        //a repetition inside the graph, scored like a drawn playout
+        if(path.closesCycle)
+        {
+            backPropagate(path, (1.0 + param(Param::DEFAULT_VALUE)) / 2.0);
+            return;
+        }
+
+        if(node->proof == Proof::UNKNOWN)
+        {
+            PerfScope scope(PerfPhase::EXPAND);
+            AllocScope allocations(AllocTag::MCTS_EXPAND);
+            node->expand(pool, nodeTable);
+
+            if(node->proof != Proof::UNKNOWN)
+                propagateProof(path);
+            else if(selectionPolicy == SelectionPolicy::PUCT)
+                assignPriors(node);
+        }
+
+        if(node->proof != Proof::UNKNOWN)
+        {
+            PerfScope scope(PerfPhase::BACKPROP);
+            backPropagate(path, node->proof == Proof::WIN ? 1 : -1);
+            return;
+        }
+
+        size_t historySize = pushPath(path);
+        double value;
+        std::vector<chess::Move>* played = nullptr;
+
+        {
+            PerfScope scope(PerfPhase::SIMULATE);
+            AllocScope allocations(AllocTag::MCTS_SIMULATE);
+
+            if(leafEvaluation == LeafEvaluation::ALPHA_BETA)
+            {
+                value = searchLeaf(node);
+            }
+            else
+            {
+                if(selectionPolicy == SelectionPolicy::UCB1)
+                {
+                    playoutMoves.clear();
+                    played = &playoutMoves;
+                }
+
+                //from the [-1, 1] scale of simulate to the win probability the tree keeps
+                value = (1.0 + node->simulate(repetitions, played)) / 2.0;
+            }
+        }
+
+        PerfScope scope(PerfPhase::BACKPROP);
+        backPropagate(path, value, played);
+
+        repetitions.resize(historySize);
+        updateHistory(path, value);
+
+        XOXO_TRACE_EVENT(TraceEvent::PLAYOUT, node->board.hash(), 0, static_cast<int>(path.nodes.size()) - 1,
+                         static_cast<int>(value * 1000), 0);
+    }
+
+    int MCTS::searchSequentialHalving(int iterations) {
+        searchStart = std::chrono::steady_clock::now();
+        XOXO_TRACE_EVENT(TraceEvent::SEARCH_BEGIN, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(iterations));
+        AllocScope allocations(AllocTag::MCTS_SEARCH);
+        lastPublish = searchStart;
+        rootChoice = -1;
+        NodeTable* nodeTable = useTable();
+
+        if(root->children.empty() && root->proof == Proof::UNKNOWN)
+            root->expand(pool, nodeTable);
+
+        if(root->children.empty() || root->proof != Proof::UNKNOWN)
+            return 0;
+
+        //the gumbel candidates are drawn by prior whatever the selection policy below the root
+        assignPriors(root);
+
+        std::vector<int> candidates;
+        for(size_t i = 0; i < root->children.size(); i++)
+        {
+            if(root->children[i]->proof != Proof::LOSS)
+                candidates.push_back(static_cast<int>(i));
+        }
+
+        //every move is proven lost, any of them will do
+        if(candidates.empty())
+        {
+            rootChoice = 0;
+            return 0;
+        }
+
+        //gumbel top-k: prior logits plus gumbel noise, the k best enter the first round. sampling without
+        //replacement this way keeps the choice an unbiased draw from the prior while a small budget goes to few moves
+        std::vector<double> gumbel(root->children.size(), 0.0);
+        if(gumbelTopK > 0)
+        {
+            std::mt19937_64 random(root->board.hash());
+            std::extreme_value_distribution<double> noise(0.0, 1.0);
+
+            for(int i : candidates)
+                gumbel[i] = noise(random) + log(std::max(static_cast<double>(root->edges[i].prior), 1e-9));
+
+            std::sort(candidates.begin(), candidates.end(), [&gumbel](int a, int b) { return gumbel[a] > gumbel[b]; });
+            candidates.resize(std::min<size_t>(candidates.size(), gumbelTopK));
+        }
+
+        //mean value for the root player, who is the one choosing here. with gumbel the value is scaled by the visits
+        //of the most visited move, so the noise decides between equals early and the values decide late
+        auto score = [this, &gumbel](int i)
+        {
+            const Node* child = root->children[i];
+            double value = child->visits > 0 ? child->wins / child->visits : 0.0;
+
+            if(gumbelTopK <= 0)
+                return value;
+
+            int maxVisits = 0;
+            for(const Edge& edge : root->edges)
+                maxVisits = std::max(maxVisits, edge.visits);
+
+            return gumbel[i] + (GUMBEL_VISIT_OFFSET + maxVisits) * GUMBEL_VALUE_SCALE * value;
+        };
+
+        int rounds = static_cast<int>(std::ceil(std::log2(static_cast<double>(candidates.size()))));
+        int done = 0;
+        bool stopped = false;
+
+        for(int round = 0; round < rounds && candidates.size() > 1 && !stopped && root->proof == Proof::UNKNOWN; round++)
+        {
+            //every remaining move gets the same share of the round. the shares are fixed before the round starts and
+            //the moves' searches only meet at the root, so a round's work can be spread over workers
+            int visitsEach = std::max(1, (iterations - done) / (rounds - round) / static_cast<int>(candidates.size()));
+
+            for(size_t c = 0; c < candidates.size() && !stopped; c++)
+            {
+                for(int v = 0; v < visitsEach && done < iterations; v++, done++)
+                {
+                    if(done % CONTROL_POLL_INTERVAL == 0 && pollControl(done))
+                    {
+                        stopped = true;
+                        break;
+                    }
+
+                    collectIfNeeded();
+                    selectNode(candidates[c]);
+                    evaluateSelection(nodeTable);
+                }
+            }
+
+            //a proven win ends the search, proven losses are out whatever their value
+            for(int i : candidates)
+            {
+                if(root->children[i]->proof == Proof::WIN)
+                {
+                    rootChoice = i;
+                    if(control != nullptr)
+                        publishSnapshot(done, true);
+                    XOXO_TRACE_EVENT(TraceEvent::SEARCH_END, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(done));
+                    return done;
+                }
+            }
+
+            std::erase_if(candidates, [this](int i) { return root->children[i]->proof == Proof::LOSS; });
+            if(candidates.empty())
+                break;
+
+            std::vector<double> scores(root->children.size());
+            for(int i : candidates)
+                scores[i] = score(i);
+
+            std::sort(candidates.begin(), candidates.end(), [&scores](int a, int b) { return scores[a] > scores[b]; });
+            candidates.resize((candidates.size() + 1) / 2);
+        }
+
+        rootChoice = candidates.empty() ? 0 : candidates[0];
+
+        if(control != nullptr)
+            publishSnapshot(done, true);
+
+        XOXO_TRACE_EVENT(TraceEvent::SEARCH_END, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(done));
+        return done;
+    }
+
+    void MCTS::propagateProof(const SelectionPath& path) {
+        provenNodes++;
+
+        for(size_t j = path.nodes.size() - 1; j-- > 0 && path.nodes[j]->updateProof();)
+            provenNodes++;
+    }
+
+    void MCTS::backPropagate(const SelectionPath& path, int result, const std::vector<chess::Move>* playout) {
+        for(size_t j = 0; j < path.nodes.size(); j++)
+        {
+            Node* node = path.nodes[j];
+            node->visits++;
+            if(result > 0)
+                node->wins++;
+
+            if(j < path.edges.size())
+                node->edges[path.edges[j]].visits++;
+        }
+
+        if(selectionPolicy == SelectionPolicy::UCB1)
+            updateAmaf(path, result > 0 ? 1.0 : 0.0, playout);
     }
 
-    void MCTS::search(int iterations) const {
-        for(int i = 0; i < iterations; i++)
+    void MCTS::backPropagate(const SelectionPath& path, double value, const std::vector<chess::Move>* playout) {
+        for(size_t j = 0; j < path.nodes.size(); j++)
+        {
+            Node* node = path.nodes[j];
+            node->visits++;
+            node->wins += value;
+
+            if(j < path.edges.size())
+                node->edges[path.edges[j]].visits++;
+        }
+
+        if(selectionPolicy == SelectionPolicy::UCB1)
+            updateAmaf(path, value, playout);
+    }
+
+    void MCTS::updateAmaf(const SelectionPath& path, double value, const std::vector<chess::Move>* playout) {
+        //moves played from the current node on, by side, as from * 64 + to
+        std::bitset<64 * 64> played[2];
+        auto key = [](chess::Move move) { return move.from().index() * 64 + move.to().index(); };
+
+        if(playout != nullptr)
+        {
+            int side = path.leaf()->board.sideToMove() == chess::Color::WHITE ? 0 : 1;
+            for(chess::Move move : *playout)
+            {
+                played[side].set(key(move));
+                side ^= 1;
+            }
+        }
+
+        //leaf first, so every node sees exactly the moves played after it, its own edge included
+        for(size_t j = path.nodes.size(); j-- > 0;)
         {
-            Node* node = selectNode();
-            node->expand();
-            int results = node->simulate();
+            Node* node = path.nodes[j];
+            int side = node->board.sideToMove() == chess::Color::WHITE ? 0 : 1;
 
-            node->backPropagate(results);
+            if(j < path.edges.size())
+                played[side].set(key(node->edges[path.edges[j]].move));
+
+            for(Edge& edge : node->edges)
+            {
+                if(played[side].test(key(edge.move)))
+                {
+                    edge.amafVisits++;
+                    edge.amafWins += static_cast<float>(value);
+                }
+            }
         }
     }
 
-    Node* MCTS::selectNode() const {
+    void MCTS::addVirtualLoss(const SelectionPath& path, int amount) {
+        for(Node* node : path.nodes)
+            node->virtualLoss += amount;
+    }
+
+    NodeTable* MCTS::useTable() {
+        if(!transpositions)
+            return nullptr;
+
+        //nodes created before the table was switched on are not in it and are simply never shared
+        if(table.nodes.empty())
+            table.nodes.emplace(root->board.hash(), root);
+
+        return &table;
+    }
+
+    MCTS::~MCTS() {
+        //with a table every node is in it exactly once, and ownership through parent may have been broken by
+        //collection
+        if(table.nodes.empty())
+        {
+            pool.destroy(root);
+            return;
+        }
+
+        for(auto& [hash, node] : table.nodes)
+            pool.release(node);
+    }
+
+    void MCTS::collectIfNeeded() {
+        if(maxNodes == 0 || pool.size() <= maxNodes || pool.size() < collectionRetry)
+            return;
+
+        collectGarbage();
+
+        //still past the mark, what is left is the root's children or shared. walking the graph again is only worth
+        //it once the pool has grown by as much as a collection frees
+        collectionRetry = pool.size() > maxNodes ? pool.size() + std::max<uint64_t>(maxNodes / 4, 1) : 0;
+    }
+
+    uint64_t MCTS::collectGarbage() {
+        const uint64_t target = maxNodes - maxNodes / 4;
+        const uint64_t before = pool.size();
+        std::vector<Node*> frontier;
+        std::vector<Node*> stack;
+
+        //every pass cuts back the current frontier, what it leaves behind becomes the next pass' frontier
+        while(pool.size() > target)
+        {
+            frontier.clear();
+
+            auto isFrontier = [this](const Node* node)
+            {
+                if(node == root || node->children.empty())
+                    return false;
+
+                bool freesAny = false;
+                for(const Node* child : node->children)
+                {
+                    if(!child->children.empty())
+                        return false;
+
+                    freesAny |= child->references == 1 && child != root;
+                }
+
+                //collapsing it would only drop edges
+                return freesAny;
+            };
+
+            if(!table.nodes.empty())
+            {
+                for(auto& [hash, node] : table.nodes)
+                {
+                    if(isFrontier(node))
+                        frontier.push_back(node);
+                }
+            }
+            else
+            {
+                stack.assign(1, root);
+                while(!stack.empty())
+                {
+                    Node* node = stack.back();
+                    stack.pop_back();
+
+                    if(isFrontier(node))
+                    {
+                        frontier.push_back(node);
+                        continue;
+                    }
+
+                    for(Node* child : node->children)
+                        stack.push_back(child);
+                }
+            }
+
+            std::sort(frontier.begin(), frontier.end(),
+                      [](const Node* a, const Node* b) { return a->visits < b->visits; });
+
+            const uint64_t passStart = pool.size();
+
+            for(Node* node : frontier)
+            {
+                if(pool.size() <= target)
+                    break;
+
+                for(Node* child : node->children)
+                {
+                    //still reached through another edge, or the root reached again through a cycle
+                    if(--child->references > 0 || child == root)
+                        continue;
+
+                    if(!table.nodes.empty())
+                        table.nodes.erase(child->board.hash());
+                    pool.release(child);
+                }
+
+                node->children.clear();
+                node->edges.clear();
+            }
+
+            if(pool.size() == passStart)
+                break;
+        }
+
+        collections++;
+        collectedNodes += before - pool.size();
+        return before - pool.size();
+    }
+
+    int MCTS::searchBatched(int iterations, int batchSize) {
+        batchSize = std::clamp(batchSize, 1, MAX_EVAL_BATCH);
+
+        BatchEvaluator evaluator;
+        //the round's selection paths, kept for their back propagation once the batch is evaluated
+        std::vector<SelectionPath> paths(batchSize);
+        std::vector<int> lanes;
+        lanes.reserve(batchSize);
+        NodeTable* nodeTable = useTable();
+
+        //a draw is worth DEFAULT_VALUE on the [-1, 1] scale simulate uses
+        const double drawValue = (1.0 + param(Param::DEFAULT_VALUE)) / 2.0;
+
+        searchStart = std::chrono::steady_clock::now();
+        XOXO_TRACE_EVENT(TraceEvent::SEARCH_BEGIN, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(iterations));
+        AllocScope allocations(AllocTag::MCTS_SEARCH);
+        lastPublish = searchStart;
+
+        int done = 0;
+        for(; done < iterations && root->proof == Proof::UNKNOWN; done += static_cast<int>(lanes.size()))
+        {
+            if(pollControl(done))
+                break;
+
+            //between rounds no path is waiting on the evaluator, so nothing still points into the tree
+            collectIfNeeded();
+
+            int roundSize = std::min(batchSize, iterations - done);
+            lanes.clear();
+            evaluator.clear();
+
+            for(int i = 0; i < roundSize; i++)
+            {
+                Node* node = selectNode();
+                addVirtualLoss(path, 1);
+
+                bool expanded = true;
+
+                if(!path.closesCycle && node->children.empty() && node->proof == Proof::UNKNOWN)
+                {
+                    PerfScope scope(PerfPhase::EXPAND);
+                    AllocScope allocations(AllocTag::MCTS_EXPAND);
+                    expanded = node->expand(pool, nodeTable);
+
+                    if(node->proof != Proof::UNKNOWN)
+                        propagateProof(path);
+                    else if(selectionPolicy == SelectionPolicy::PUCT)
+                        assignPriors(node);
+                }
+
+                //proven, no legal moves or a repetition inside the graph, the result is known and does not need the
+                //evaluator. a node the pool had no room to expand still has moves and is evaluated like any other leaf
+                if(path.closesCycle || node->proof != Proof::UNKNOWN || (expanded && node->children.empty()))
+                {
+                    lanes.push_back(-1);
+                }
+                else
+                {
+                    lanes.push_back(evaluator.add(node->board));
+                }
+
+                std::swap(paths[i], path);
+            }
+
+            {
+                PerfScope scope(PerfPhase::SIMULATE);
+                AllocScope allocations(AllocTag::MCTS_SIMULATE);
+                evaluator.evaluate();
+            }
+
+            for(size_t i = 0; i < lanes.size(); i++)
+            {
+                const SelectionPath& leafPath = paths[i];
+                Node* node = leafPath.leaf();
+                double value;
+
+                if(lanes[i] < 0)
+                {
+                    if(!leafPath.closesCycle && node->proof != Proof::UNKNOWN)
+                        value = node->proof == Proof::WIN ? 1.0 : 0.0;
+                    else
+                        value = drawValue;
+                }
+                else
+                {
+                    int score = evaluator.score(lanes[i]);
+                    value = scoreToWinProbability(node->us == chess::Color::WHITE ? score : -score);
+                }
+
+                PerfScope scope(PerfPhase::BACKPROP);
+                addVirtualLoss(leafPath, -1);
+                backPropagate(leafPath, value);
+                updateHistory(leafPath, value);
+
+                XOXO_TRACE_EVENT(TraceEvent::PLAYOUT, node->board.hash(), 0,
+                                 static_cast<int>(leafPath.nodes.size()) - 1, static_cast<int>(value * 1000), 0);
+            }
+        }
+
+        if(control != nullptr)
+            publishSnapshot(done, true);
+
+        XOXO_TRACE_EVENT(TraceEvent::SEARCH_END, root->board.hash(), 0, 0, 0, static_cast<uint32_t>(done));
+        return done;
+    }
+
+    void MCTS::assignPriors(Node* node) const {
+        if(node->children.empty())
+            return;
+
+        const chess::Board& board = node->board;
+        int side = board.sideToMove() == chess::Color::WHITE ? 0 : 1;
+        std::vector<double> logits(node->children.size());
+        double maxLogit = -std::numeric_limits<double>::infinity();
+
+        for(size_t i = 0; i < node->children.size(); i++)
+        {
+            const Node* child = node->children[i];
+            chess::Move move = node->edges[i].move;
+            double logit = 0;
+
+            //winning captures are pushed up, captures losing the exchange and moves leaving a piece en prise down
+            logit += PRIOR_SEE_WEIGHT * see(board, move) / 100.0;
+
+            if(child->board.inCheck())
+                logit += PRIOR_CHECK_WEIGHT;
+
+            double count = history[(side * 64 + move.from().index()) * 64 + move.to().index()];
+            logit += PRIOR_HISTORY_WEIGHT * count / (count + HISTORY_SCALE);
+            logit += PRIOR_PST_WEIGHT * MinMax::getPieceSquareDelta(board, move) / 100.0;
+
+            logits[i] = logit;
+            maxLogit = std::max(maxLogit, logit);
+        }
+
+        double sum = 0;
+        for(double& logit : logits)
+        {
+            logit = exp(logit - maxLogit);
+            sum += logit;
+        }
+
+        for(size_t i = 0; i < node->children.size(); i++)
+            node->edges[i].prior = static_cast<float>(logits[i] / sum);
+    }
+
+    void MCTS::updateHistory(const SelectionPath& path, double value) {
+        for(size_t j = 0; j + 1 < path.nodes.size(); j++)
+        {
+            const Node* node = path.nodes[j];
+            chess::Move move = node->edges[path.edges[j]].move;
+            chess::Color mover = node->board.sideToMove();
+            double moverValue = mover == root->us ? value : 1.0 - value;
+
+            if(moverValue > 0.5)
+            {
+                int side = mover == chess::Color::WHITE ? 0 : 1;
+                history[(side * 64 + move.from().index()) * 64 + move.to().index()]++;
+            }
+        }
+    }
+
+    double MCTS::searchLeaf(Node* node) {
+        MinMax::SearchContext context;
+        context.maxDepth = leafDepth;
+        context.deadline = std::chrono::steady_clock::now() + leafBudget;
+        context.repetitions = &repetitions;
+
+        chess::Board leafBoard(node->board);
+        chess::Move move;
+        int score = MinMax::searchPosition(leafBoard, context, move);
+
+        return scoreToWinProbability(leafBoard.sideToMove() == node->us ? score : -score);
+    }
+
+    bool MCTS::pollControl(int iterations) {
+        if(control == nullptr)
+            return false;
+
+        if(control->stop.load(std::memory_order_relaxed))
+            return true;
+
+        if(std::chrono::steady_clock::now() - lastPublish >= SNAPSHOT_INTERVAL)
+            publishSnapshot(iterations, false);
+
+        return false;
+    }
+
+    void MCTS::publishSnapshot(int iterations, bool finished) {
+        SearchSnapshot snapshot;
+        auto now = std::chrono::steady_clock::now();
+        lastPublish = now;
+
+        snapshot.iterations = iterations;
+        snapshot.seconds = std::chrono::duration<double>(now - searchStart).count();
+        snapshot.nps = snapshot.seconds > 0 ? iterations / snapshot.seconds : 0;
+        snapshot.depth = selectionDepth;
+        snapshot.finished = finished;
+
+        std::vector<size_t> order(root->children.size());
+        for(size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+            { return root->children[a]->visits > root->children[b]->visits; });
+
+        snapshot.rootMoveCount = std::min(static_cast<int>(order.size()), SNAPSHOT_ROOT_MOVES);
+
+        for(int i = 0; i < snapshot.rootMoveCount; i++)
+        {
+            const Node* child = root->children[order[i]];
+            const Edge& edge = root->edges[order[i]];
+            RootMoveInfo& info = snapshot.rootMoves[i];
+
+            chess::uci::moveToUci(edge.move).copy(info.uci, sizeof(info.uci) - 1);
+            info.visits = child->visits;
+            info.value = child->visits > 0 ? static_cast<float>(child->wins / child->visits) : 0.0f;
+            info.prior = static_cast<float>(edge.prior);
+        }
+
+        if(Node* best = getBestNode())
+            best->uciString.copy(snapshot.bestMove, sizeof(snapshot.bestMove) - 1);
+
+        control->snapshots.publish(snapshot);
+    }
+
+    size_t MCTS::pushPath(const SelectionPath& path) {
+        size_t historySize = repetitions.size();
+
+        //root first, so the newest key ends up on top
+        for(size_t j = 0; j + 1 < path.nodes.size(); j++)
+            repetitions.push(path.nodes[j]->board.hash());
+
+        return historySize;
+    }
+
+    Node* MCTS::selectNode(int rootEdge) {
+        PerfScope scope(PerfPhase::SELECT);
+        path.nodes.clear();
+        path.edges.clear();
+        path.closesCycle = false;
+
         Node* currentNode = root;
-        while(!currentNode->children.empty())
+        path.nodes.push_back(root);
+
+        //a proven node is scored from its proof, there is nothing left to learn below it
+        while(!currentNode->children.empty() && currentNode->proof == Proof::UNKNOWN)
         {
-            currentNode = currentNode->selectChild();
+            int edge = rootEdge >= 0 && path.nodes.size() == 1 ? rootEdge : currentNode->selectEdge(selectionPolicy);
+            Node* next = currentNode->children[edge];
+            path.edges.push_back(edge);
+
+            //only a graph can lead back into the line being selected
+            if(transpositions && std::find(path.nodes.begin(), path.nodes.end(), next) != path.nodes.end())
+            {
+                path.closesCycle = true;
+                break;
+            }
+
+            path.nodes.push_back(next);
+            currentNode = next;
         }
 
+        selectionDepth = std::max(selectionDepth, static_cast<int>(path.nodes.size()) - 1);
+
+        XOXO_TRACE_EVENT(TraceEvent::SELECT, currentNode->board.hash(),
+                         path.edges.empty() ? 0 : root->edges[path.edges[0]].move.move(),
+                         static_cast<int>(path.nodes.size()) - 1, 0, static_cast<uint32_t>(currentNode->visits));
+
         return currentNode;
     }
 
     Node* MCTS::getBestNode() {
+        //sequential halving has settled on a move already, only a proven win overrides it
+        if(rootChoice >= 0 && rootChoice < static_cast<int>(root->children.size()))
+        {
+            for(Node* child : root->children)
+            {
+                if(child->proof == Proof::WIN)
+                    return child;
+            }
+
+            return root->children[rootChoice];
+        }
+
         Node* best_child = nullptr;
         double best_score = -1;
 
         for(Node* child : root->children)
         {
+            if(child->proof == Proof::WIN)
+                return child;
+
+            if(child->proof == Proof::LOSS)
+                continue;
+
             double score;
 
-            score = static_cast<double>(child->wins) / (child->visits + EPSILON) + child->getRaveScore();
+            //puct concentrates visits on the moves it believes in, so the visit count is the robust choice
+            if(selectionPolicy == SelectionPolicy::PUCT)
+                score = child->visits;
+            else
+                score = static_cast<double>(child->wins) / (child->visits + EPSILON);
 
             if(score > best_score)
             {
                 best_score = score;
                 best_child = child;
             }
-
-            if(score == best_score && child->children.size() < best_child->children.size())
+            else if(score == best_score && child->visits > best_child->visits)
             {
+                //equal values, the better explored one is the safer bet
                 best_child = child;
             }
         }
 
-        if(best_child == nullptr)
-            return nullptr;
+        //every move is proven lost, any of them will do
+        if(best_child == nullptr && !root->children.empty())
+            return root->children[0];
 
         return best_child;
     }
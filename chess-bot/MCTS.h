@@ -5,44 +5,268 @@
 #ifndef CHESS_MCTS_H
 #define CHESS_MCTS_H
 
+#include <chrono>
+#include <new>
 #include <random>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "chess.hpp"
+#include "EngineMemory.h"
+#include "Terminal.h"
+#include "SearchControl.h"
 
 namespace xoxo {
 
-    const double DEFAULT_VALUE = -0.3;
+    //how a selected leaf is given a value
+    enum class LeafEvaluation {
+        //greedy playout to the end of the game
+        ROLLOUT,
+        //shallow, time bounded alpha-beta with quiescence on the shared transposition table
+        ALPHA_BETA
+    };
+
+    //how Node::selectChild scores children
+    enum class SelectionPolicy {
+        UCB1,
+        //prior weighted exploration, priors come from cheap move heuristics
+        PUCT
+    };
+
+    //how search spreads its budget over the root's moves
+    enum class RootPolicy {
+        //the selection policy decides at the root like everywhere else
+        SELECTION,
+        //rounds of equal visits for every remaining root move, the worse half is dropped after each round
+        SEQUENTIAL_HALVING
+    };
+
+    //game theoretic value of a node from our (the root player's) point of view
+    enum class Proof : int8_t {
+        UNKNOWN,
+        WIN,
+        LOSS
+    };
+
+    //playout evaluation, material from the side to move's point of view
+    int getMaterialScore(const chess::Board& board);
+    //material and king safety from the side to move's point of view, cached in EvalCache::mcts()
+    int getBoardScore(chess::Board& board);
+
+    class Node;
+
+    //positions already in the search graph by zobrist key, lets every move order reaching a position share one node
+    struct NodeTable {
+        std::unordered_map<uint64_t, Node*> nodes;
+        //edges made by expansions, and how many of them led to a position that was already in the graph
+        uint64_t edges = 0;
+        uint64_t mergedEdges = 0;
+
+        double mergedRatio() const { return edges > 0 ? static_cast<double>(mergedEdges) / edges : 0.0; }
+    };
+
+    //nodes carved out of engine memory in chunk sized slabs, freed nodes are reused before another slab is taken.
+    //the first slab may take the chunks the budget holds back, so a search can start after the tables took the rest
+    class NodePool {
+    public:
+        NodePool() = default;
+        ~NodePool();
+        NodePool(const NodePool&) = delete;
+        NodePool& operator=(const NodePool&) = delete;
+
+        //nullptr once the engine memory budget is spent
+        Node* create(const chess::Board& board, const chess::Move* move, Node* parent, chess::Color us);
+        //destroys node and everything below it that it created, nodes it reaches by transposition belong to their
+        //creator
+        void destroy(Node* node);
+        //destroys node alone, whatever is left in its children is not touched
+        void release(Node* node);
+
+        uint64_t size() const { return liveNodes; }
+        uint64_t bytes() const { return slabs.size() * MEMORY_CHUNK; }
+        //nodes released so far, a failed expansion is only worth retrying once this has moved
+        uint64_t releases() const { return releasedNodes; }
+
+    private:
+        std::vector<void*> slabs;
+        //freed slots, each one holds a pointer to the next
+        void* freeList = nullptr;
+        char* cursor = nullptr;
+        char* slabEnd = nullptr;
+        uint64_t liveNodes = 0;
+        uint64_t releasedNodes = 0;
+    };
+
+    //what belongs to a move rather than to the position it leads to, a node shared by transpositions is reached
+    //over several edges
+    struct Edge {
+        chess::Move move;
+        //share of the parent's exploration this move gets under PUCT
+        float prior = 0;
+        //selections through this edge. the child's own visits also count the ones that came over other edges
+        int visits = 0;
+        //all-moves-as-first: simulations through the parent in which its side to move played this move at any
+        //later point, and what we (the root player) won of them
+        int amafVisits = 0;
+        float amafWins = 0;
+    };
 
     class Node {
     public:
-        Node(chess::Board b, chess::Move* m, Node* p, chess::Color c);
+        Node(chess::Board b, const chess::Move* m, Node* p, chess::Color c);
 
         chess::Board board;
         chess::Color us;
-        chess::Move* move;
+        //the move that led here from parent, NO_MOVE at the root
+        chess::Move move;
+        //the node that created this one. with transpositions other nodes lead here too, so the searches walk the
+        //selection path instead of parent pointers
         Node* parent;
         std::vector<Node*> children;
+        //edges[i] leads to children[i]
+        std::vector<Edge> edges;
         int visits = 0;
-        int wins = 0;
+        double wins = 0;
+        //pending batched evaluations below this node, counted as visits that did not win
+        int virtualLoss = 0;
+        //edges leading here, more than one only when transpositions are shared
+        int references = 0;
+        //expand ran out of memory here, the node stays a leaf until the pool has released this many nodes
+        uint64_t expansionRetry = 0;
+        Proof proof = Proof::UNKNOWN;
         std::string uciString;
 
-        Node* selectChild();
-        void expand();
-        int simulate();
-        void backPropagate(int result);
-        double getRaveScore() const;
+        //index of the edge to follow, -1 without children
+        int selectEdge(SelectionPolicy policy = SelectionPolicy::UCB1);
+        Node* selectChild(SelectionPolicy policy = SelectionPolicy::UCB1);
+        //false when the pool ran out of memory, or did the last time and has freed nothing since, the node is then
+        //left without children. with a table, children whose position is already in it are shared instead of created
+        bool expand(NodePool& pool, NodeTable* table = nullptr);
+        //repetitions holds the keys of every position before this node and is grown by the playout, the caller
+        //truncates it back afterwards. played, when given, receives the playout's moves. the result is on the [-1, 1]
+        //scale from us's point of view, a draw is worth DEFAULT_VALUE
+        double simulate(RepetitionStack& repetitions, std::vector<chess::Move>* played = nullptr);
+        //derives this node's proof from its children, returns true if it just became proven
+        bool updateProof();
+    };
+
+    //root to leaf as selected, edges[j] is the index of the edge taken out of nodes[j]
+    struct SelectionPath {
+        std::vector<Node*> nodes;
+        std::vector<int> edges;
+        //the last edge leads back to a node already on the path, the position repeats there. edges then has as
+        //many entries as nodes
+        bool closesCycle = false;
+
+        Node* leaf() const { return nodes.back(); }
     };
 
     class MCTS {
     public:
         chess::Board board;
+        //owns the tree, declared before root so it outlives it
+        NodePool pool;
         Node* root;
+        //nodes whose result was proven (terminal or from their children) during this search
+        int provenNodes = 0;
+        //keys of the game positions before the root, fill it in before searching to see repetitions of the game
+        RepetitionStack repetitions;
+
+        SelectionPolicy selectionPolicy = SelectionPolicy::PUCT;
+        RootPolicy rootPolicy = RootPolicy::SELECTION;
+        //under sequential halving only the k root moves with the best prior plus gumbel noise enter the first round,
+        //0 lets every move in
+        int gumbelTopK = 0;
+        //index into root->children of the move sequential halving settled on, -1 when it did not run
+        int rootChoice = -1;
+        //share nodes between move orders that reach the same position, the tree becomes a directed graph. set it
+        //before the first search
+        bool transpositions = false;
+        NodeTable table;
+        //the last selection
+        SelectionPath path;
+        //high-water mark of the node pool, 0 for none. past it the least visited subtrees are cut back to leaves
+        //until a quarter of the mark is free again, so a search of any length keeps a fixed footprint
+        uint64_t maxNodes = 0;
+        int collections = 0;
+        uint64_t collectedNodes = 0;
+        //a collection that could not reach the low-water mark is not tried again until the pool has this many nodes
+        uint64_t collectionRetry = 0;
+        LeafEvaluation leafEvaluation = LeafEvaluation::ROLLOUT;
+        int leafDepth = 2;
+        std::chrono::microseconds leafBudget{2000};
+        //butterfly table of moves that won playouts, by side, from and to square
+        std::vector<int> history = std::vector<int>(2 * 64 * 64, 0);
+        //moves of the last rollout
+        std::vector<chess::Move> playoutMoves;
+
+        //set to make the search stoppable and observable from another thread
+        SearchControl* control = nullptr;
+        int selectionDepth = 0;
+        std::chrono::steady_clock::time_point searchStart;
+        std::chrono::steady_clock::time_point lastPublish;
+
+        //throws std::bad_alloc when not even the root fits in the budget
+        MCTS(const chess::Board* b) : board(*b), root(pool.create(board, nullptr, nullptr, board.sideToMove()))
+        {
+            if(root == nullptr)
+                throw std::bad_alloc();
+        }
+        ~MCTS();
+        MCTS(const MCTS&) = delete;
+        MCTS& operator=(const MCTS&) = delete;
+
+        //both searches stop early once the root is proven and return the iterations they actually ran
+        int search(int iterations);
+        //search under RootPolicy::SEQUENTIAL_HALVING
+        int searchSequentialHalving(int iterations);
+        //expands the selected leaf, scores it and backs the value up the path
+        void evaluateSelection(NodeTable* nodeTable);
+
+        //selects up to batchSize leaves per round, spreading them with virtual loss, then scores them all at once
+        //with the batch evaluator instead of playing them out
+        int searchBatched(int iterations, int batchSize);
+
+        //pushes a freshly proven leaf's result up the path as far as it decides its ancestors
+        void propagateProof(const SelectionPath& path);
+
+        //fills path and returns its leaf, rootEdge (when not -1) is taken out of the root instead of selecting
+        Node *selectNode(int rootEdge = -1);
+
+        //statistics are updated along the selection path, which is the only way back up from a shared node.
+        //playout holds the moves a rollout played from the leaf, they count for the amaf statistics
+        void backPropagate(const SelectionPath& path, int result, const std::vector<chess::Move>* playout = nullptr);
+        //value is the probability in [0, 1] that we win from the leaf
+        void backPropagate(const SelectionPath& path, double value, const std::vector<chess::Move>* playout = nullptr);
+        //credits every edge on the path whose move its side played later in the simulation, only UCB1 reads them
+        void updateAmaf(const SelectionPath& path, double value, const std::vector<chess::Move>* playout);
+        void addVirtualLoss(const SelectionPath& path, int amount);
+
+        //softmax over capture, check, history and piece-square heuristics of node's children
+        void assignPriors(Node* node) const;
+        //moves on the path that won for the side playing them get a history bump
+        void updateHistory(const SelectionPath& path, double value);
+
+        //probability that we win from node according to a shallow alpha-beta search
+        double searchLeaf(Node* node);
+
+        //the node table when transpositions are on, with the root in it
+        NodeTable* useTable();
 
-        MCTS(const chess::Board* b) : board(*b), root(new Node(board, nullptr, nullptr, board.sideToMove())) {}
+        //collects when the pool is past maxNodes, only ever called between iterations
+        void collectIfNeeded();
+        //turns expanded nodes whose children are all leaves back into leaves, least visited first, until the pool
+        //is down to the low-water mark. a node none of whose children would be freed, all of them reached through
+        //other edges too, is left alone. statistics and proofs of the collapsed nodes stay, their children go and are
+        //expanded again if selection comes back. returns the nodes freed
+        uint64_t collectGarbage();
 
-        void search(int iterations) const;
+        //publishes a snapshot when one is due and returns true once told to stop
+        bool pollControl(int iterations);
+        void publishSnapshot(int iterations, bool finished);
 
-        Node *selectNode() const;
+        //adds the keys of the leaf's ancestors on path to repetitions, returns the size to truncate back to
+        size_t pushPath(const SelectionPath& path);
 
         Node* getBestNode();
     };
@@ -0,0 +1,256 @@
+#include "MateSolver.h"
+#include "EngineMemory.h"
+#include "AllocationProfiler.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+#include <new>
+
+namespace xoxo {
+
+    //proven or disproven, sums saturate here
+    const uint32_t PROOF_INFINITY = 1u << 30;
+    //the deadline is only read every this many nodes
+    const uint64_t MATE_CLOCK_INTERVAL = 1024;
+
+    const ProofNumbers LOST = {PROOF_INFINITY, 0};
+    const ProofNumbers WON = {0, PROOF_INFINITY};
+    //entries mean different things for the two attackers, black's keys are moved out of the way of white's
+    const uint64_t BLACK_ATTACKER_KEY = 0x6A09E667F3BCC909ULL;
+
+    struct MateChild {
+        chess::Move move;
+        ProofNumbers numbers;
+        //a repetition of the line, its value is a draw whatever the table says
+        bool repetition;
+    };
+
+    MateSolver::MateSolver(int entries)
+    {
+        //round down to a power of two so the index is a mask
+        uint64_t size = std::bit_floor(static_cast<uint64_t>(entries > 0 ? entries : 1));
+        void* block = EngineMemory::global().allocate(size * sizeof(MateEntry), MemoryTag::MATE_TABLE);
+        if(block == nullptr)
+            throw std::bad_alloc();
+
+        table = static_cast<MateEntry*>(block);
+        std::uninitialized_value_construct_n(table, size);
+        mask = size - 1;
+    }
+
+    MateSolver::~MateSolver()
+    {
+        EngineMemory::global().release(table, (mask + 1) * sizeof(MateEntry), MemoryTag::MATE_TABLE);
+    }
+
+    bool MateSolver::solve(chess::Board& board, const RepetitionStack& repetitions, chess::Move& move)
+    {
+        AllocScope allocations(AllocTag::MATE_SOLVER);
+        this->board = &board;
+        history = repetitions;
+        attacker = board.sideToMove();
+        rootMove = chess::Move::NO_MOVE;
+        aborted = false;
+        nodes = 0;
+
+        ProofNumbers root = search(PROOF_INFINITY - 1, PROOF_INFINITY - 1, 0);
+        this->board = nullptr;
+
+        if(root.phi != 0 || rootMove == chess::Move::NO_MOVE)
+            return false;
+
+        move = rootMove;
+        return true;
+    }
+
+    void MateSolver::clear()
+    {
+        std::fill(table, table + mask + 1, MateEntry{});
+    }
+
+    MateSolver* MateSolver::local()
+    {
+        static thread_local std::unique_ptr<MateSolver> solver;
+
+        if(solver == nullptr)
+        {
+            try
+            {
+                solver = std::make_unique<MateSolver>();
+            }
+            catch(const std::bad_alloc&)
+            {
+                return nullptr;
+            }
+        }
+
+        return solver.get();
+    }
+
+    bool MateSolver::probe(uint64_t key, ProofNumbers& numbers) const
+    {
+        const MateEntry& entry = table[key & mask];
+        if(entry.key != key)
+            return false;
+
+        numbers = entry.numbers;
+        return true;
+    }
+
+    void MateSolver::store(uint64_t key, const ProofNumbers& numbers)
+    {
+        MateEntry& entry = table[key & mask];
+        entry.key = key;
+        entry.numbers = numbers;
+    }
+
+    bool MateSolver::outOfBudget()
+    {
+        if(nodes >= nodeLimit)
+            aborted = true;
+        else if(nodes % MATE_CLOCK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline)
+            aborted = true;
+
+        return aborted;
+    }
+
+    ProofNumbers MateSolver::search(uint32_t thresholdPhi, uint32_t thresholdDelta, int ply)
+    {
+        const uint64_t salt = attacker == chess::Color::BLACK ? BLACK_ATTACKER_KEY : 0;
+        const uint64_t key = board->hash() ^ salt;
+        const bool attacking = board->sideToMove() == attacker;
+        //a draw is a loss for the attacker and a win for the defender
+        const ProofNumbers drawn = attacking ? LOST : WON;
+
+        nodes++;
+
+        //never cut at the root: a position proven by an earlier solve is stored without its move, so the root has
+        //to look at its children again to name one. they are in the table too, which makes this cheap
+        ProofNumbers numbers;
+        if(ply > 0 && probe(key, numbers) && (numbers.phi >= thresholdPhi || numbers.delta >= thresholdDelta))
+            return numbers;
+
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, *board);
+
+        switch(getTerminal(*board, moves, &history))
+        {
+            case Terminal::NONE:
+                break;
+            case Terminal::CHECKMATE:
+                store(key, LOST);
+                return LOST;
+            //depends on the line, never stored
+            case Terminal::REPETITION:
+                return drawn;
+            default:
+                store(key, drawn);
+                return drawn;
+        }
+
+        //given up on, not stored so a shorter line to the same position can still prove it
+        if(ply >= MAX_MATE_PLY)
+            return drawn;
+
+        std::vector<MateChild> children;
+        children.reserve(moves.size());
+        history.push(board->hash());
+
+        for(const chess::Move& move : moves)
+        {
+            board->makeMove(move);
+
+            if(!attacking || board->inCheck())
+            {
+                bool repetition = history.isRepetition(board->hash(), static_cast<int>(board->halfMoveClock()));
+                ProofNumbers childNumbers;
+                if(repetition)
+                    childNumbers = board->sideToMove() == attacker ? LOST : WON;
+                else
+                    probe(board->hash() ^ salt, childNumbers);
+
+                children.push_back({move, childNumbers, repetition});
+            }
+
+            board->unmakeMove(move);
+        }
+
+        //no check left to give
+        if(children.empty())
+        {
+            history.pop();
+            store(key, drawn);
+            return drawn;
+        }
+
+        while(true)
+        {
+            //phi is the cheapest child to refute, delta the work of refuting every child
+            numbers.phi = PROOF_INFINITY;
+            numbers.delta = 0;
+            size_t best = 0;
+            uint32_t secondDelta = PROOF_INFINITY;
+
+            for(size_t i = 0; i < children.size(); i++)
+            {
+                const MateChild& child = children[i];
+
+                if(child.numbers.delta < numbers.phi)
+                {
+                    secondDelta = numbers.phi;
+                    numbers.phi = child.numbers.delta;
+                    best = i;
+                }
+                else if(child.numbers.delta < secondDelta)
+                {
+                    secondDelta = child.numbers.delta;
+                }
+
+                numbers.delta = std::min(PROOF_INFINITY, numbers.delta + child.numbers.phi);
+            }
+
+            if(ply == 0 && numbers.phi == 0)
+                rootMove = children[best].move;
+
+            if(numbers.phi >= thresholdPhi || numbers.delta >= thresholdDelta || outOfBudget())
+                break;
+
+            //the best child is searched until it is no longer the best, or until this node crosses a threshold
+            MateChild& child = children[best];
+            uint32_t childPhi = thresholdDelta - (numbers.delta - child.numbers.phi);
+            uint32_t childDelta = std::min(thresholdPhi, secondDelta + 1);
+
+            board->makeMove(child.move);
+            child.numbers = search(childPhi, childDelta, ply + 1);
+            board->unmakeMove(child.move);
+        }
+
+        history.pop();
+        store(key, numbers);
+        return numbers;
+    }
+
+    bool hasForcingCheck(chess::Board& board, const chess::Movelist& moves, int maxReplies)
+    {
+        for(const chess::Move& move : moves)
+        {
+            board.makeMove(move);
+            bool forcing = false;
+
+            if(board.inCheck())
+            {
+                chess::Movelist replies;
+                chess::movegen::legalmoves(replies, board);
+                forcing = replies.size() <= maxReplies;
+            }
+
+            board.unmakeMove(move);
+
+            if(forcing)
+                return true;
+        }
+
+        return false;
+    }
+
+} // xoxo
@@ -0,0 +1,78 @@
+#ifndef CHESS_MATESOLVER_H
+#define CHESS_MATESOLVER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "chess.hpp"
+#include "Terminal.h"
+
+namespace xoxo {
+
+    const int DEFAULT_MATE_TABLE_ENTRIES = 1 << 18;
+    const uint64_t DEFAULT_MATE_NODES = 200000;
+    //lines longer than this are given up on, it also bounds the recursion
+    const int MAX_MATE_PLY = 64;
+
+    //proof and disproof numbers from the point of view of the side to move: phi is the work left to show that side
+    //reaches its goal, delta the work left to show it does not. the attacker's goal is mate, the defender's to
+    //escape it
+    struct ProofNumbers {
+        uint32_t phi = 1;
+        uint32_t delta = 1;
+    };
+
+    struct MateEntry {
+        uint64_t key = 0;
+        ProofNumbers numbers;
+    };
+
+    //depth-first proof-number search (df-pn) for a forced mate by the side to move. the attacker only ever plays
+    //checks, so the tree stays narrow enough to prove mates alpha-beta and MCTS would need far deeper searches for.
+    //a repetition inside the line is a draw and a draw always counts as an escape, so a proof never leans on a
+    //path dependent result and can be trusted, while a disproof only means no mate was found
+    class MateSolver {
+    public:
+        //the table comes out of the engine memory budget, throws std::bad_alloc when it is spent. local() catches it
+        explicit MateSolver(int entries = DEFAULT_MATE_TABLE_ENTRIES);
+        ~MateSolver();
+        MateSolver(const MateSolver&) = delete;
+        MateSolver& operator=(const MateSolver&) = delete;
+
+        uint64_t nodeLimit = DEFAULT_MATE_NODES;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        //positions entered by the last solve
+        uint64_t nodes = 0;
+
+        //true when the side to move mates by force, move is then the first move of the proof. repetitions is the
+        //game history that led to board
+        bool solve(chess::Board& board, const RepetitionStack& repetitions, chess::Move& move);
+        void clear();
+
+        //one solver per thread, like the pawn hash. nullptr while the budget has no room for its table, the caller
+        //then goes without the solver and the next call tries again
+        static MateSolver* local();
+
+    private:
+        ProofNumbers search(uint32_t thresholdPhi, uint32_t thresholdDelta, int ply);
+        bool probe(uint64_t key, ProofNumbers& numbers) const;
+        void store(uint64_t key, const ProofNumbers& numbers);
+        bool outOfBudget();
+
+        MateEntry* table = nullptr;
+        uint64_t mask;
+
+        chess::Board* board = nullptr;
+        RepetitionStack history;
+        chess::Color attacker = chess::Color::WHITE;
+        chess::Move rootMove = chess::Move::NO_MOVE;
+        bool aborted = false;
+    };
+
+    //whether some legal move gives check and leaves the defender at most maxReplies answers. without a check the
+    //solver has nothing to try, and loose checks seldom lead anywhere it can prove in a small budget
+    bool hasForcingCheck(chess::Board& board, const chess::Movelist& moves, int maxReplies);
+
+} // xoxo
+
+#endif //CHESS_MATESOLVER_H
@@ -3,212 +3,472 @@
 //
 
 #include "MinMax.h"
+#include "PawnHash.h"
+#include "EvalCache.h"
+#include "TranspositionTable.h"
+#include "SEE.h"
+#include "EvalTables.h"
+#include "SearchTrace.h"
+#include "PerfCounters.h"
+#include "AllocationProfiler.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+void orderMoves(const chess::Board& board, chess::Movelist& moves, chess::Move hashMove);
+void orderCaptures(const chess::Board& board, chess::Movelist& captures);
+
+template <bool Maximizing>
+int MinMax::minmaxNegamax(int depth, chess::Board& board, chess::Move& bestMove, const chess::Movelist& initialMoves, int alpha, int beta,
+                          xoxo::RepetitionStack* repetitions)
+{
+    //leaf scores are the maximizer's, the minimizer sees them negated
+    constexpr int sign = Maximizing ? 1 : -1;
 
-int pawnValues[64] =
-        {
-                0,  0,  0,  0,  0,  0,  0,  0,
-                50, 50, 50, 50, 50, 50, 50, 5,
-                10, 10, 20, 30, 30, 20, 10, 10,
-                5,  5, 10, 25, 25, 10,  5,  5,
-                0,  0,  0, 20, 20,  0,  0,  0,
-                5, -5,-10,  0,  0,-10, -5,  5,
-                5, 10, 10,-20,-20, 10, 10,  5,
-                0,  0,  0,  0,  0,  0,  0,  0
-        };
-
-int knightValues[64] =
-        {
-                -50,-40,-30,-30,-30,-30,-40,-50,
-                -40,-20,  0,  0,  0,  0,-20,-40,
-                -30,  0, 10, 15, 15, 10,  0,-30,
-                -30,  5, 15, 20, 20, 15,  5,-30,
-                -30,  0, 15, 20, 20, 15,  0,-30,
-                -30,  5, 10, 15, 15, 10,  5,-30,
-                -40,-20,  0,  5,  5,  0,-20,-40,
-                -50,-40,-30,-30,-30,-30,-40,-50
-        };
-
-int bishopValues[64] =
-        {
-                -20,-10,-10,-10,-10,-10,-10,-20,
-                -10,  0,  0,  0,  0,  0,  0,-10,
-                -10,  0,  5, 10, 10,  5,  0,-10,
-                -10,  5,  5, 10, 10,  5,  5,-10,
-                -10,  0, 10, 10, 10, 10,  0,-10,
-                -10, 10, 10, 10, 10, 10, 10,-10,
-                -10,  5,  0,  0,  0,  0,  5,-10,
-                -20,-10,-10,-10,-10,-10,-10,-20
-        };
-
-int rookValues[64] =
-        {
-                0,  0,  0,  0,  0,  0,  0,  0,
-                5, 10, 10, 10, 10, 10, 10,  5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                -5,  0,  0,  0,  0,  0,  0, -5,
-                0,  0,  0,  5,  5,  0,  0,  0
-        };
-
-int queenValues[64] =
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+
+    //mates and draws are detected from the moves generated for this node instead of a second generation in isGameOver
+    xoxo::Terminal terminal = xoxo::getTerminal(board, moves, repetitions);
+
+    if (depth == 0 || terminal != xoxo::Terminal::NONE)
+    {
+        //determine the board score
+        return sign * (MinMax::getBoardScore(board) + MinMax::getTerminalScore(terminal, !Maximizing));
+    }
+
+    //winning captures first and losing ones last gets the cutoffs early
+    orderMoves(board, moves, chess::Move::NO_MOVE);
+
+    chess::Board tempBoard(board);
+    int bestValue = -std::numeric_limits<int>::max();
+
+    for (chess::Move move : moves)
+    {
+        if (repetitions != nullptr)
+            repetitions->push(tempBoard.hash());
+
+        tempBoard.makeMove(move);
+
+        int evaluation = -minmaxNegamax<!Maximizing>(depth - 1, tempBoard, bestMove, initialMoves, -beta, -alpha, repetitions);
+
+        if (repetitions != nullptr)
+            repetitions->pop();
+
+        bestValue = std::max(bestValue, evaluation);
+        alpha = std::max(alpha, evaluation);
+
+        if (beta <= alpha)
         {
-                -20,-10,-10, -5, -5,-10,-10,-20,
-                -10,  0,  0,  0,  0,  0,  0,-10,
-                -10,  0,  5,  5,  5,  5,  0,-10,
-                -5,  0,  5,  5,  5,  5,  0, -5,
-                0,  0,  5,  5,  5,  5,  0, -5,
-                -10,  5,  5,  5,  5,  5,  0,-10,
-                -10,  0,  5,  0,  0,  0,  0,-10,
-                -20,-10,-10, -5, -5,-10,-10,-20
-        };
-
-int kingValues[64] =
+            tempBoard.unmakeMove(move);
+            break;
+        }
+
+        if (bestValue == evaluation && initialMoves.find(move) != -1)
         {
-                -30,-40,-40,-50,-50,-40,-40,-30,
-                -30,-40,-40,-50,-50,-40,-40,-30,
-                -30,-40,-40,-50,-50,-40,-40,-30,
-                -30,-40,-40,-50,-50,-40,-40,-30,
-                -20,-30,-30,-40,-40,-30,-30,-20,
-                -10,-20,-20,-20,-20,-20,-20,-10,
-                20, 20,  0,  0,  0,  0, 20, 20,
-                20, 30, 10,  0,  0, 10, 30, 20
-        };
-
-int MinMax::minmaxMove(int depth, bool isMaximizing, chess::Board& board, chess::Move& bestMove, const chess::Movelist& initialMoves, int alpha, int beta)
+            bestMove = move;
+        }
+
+        tempBoard.unmakeMove(move);
+    }
+
+    return bestValue;
+}
+
+int MinMax::minmaxMove(int depth, bool isMaximizing, chess::Board& board, chess::Move& bestMove, const chess::Movelist& initialMoves, int alpha, int beta,
+                       xoxo::RepetitionStack* repetitions)
 {
-    if (depth == 0)
+    //the window is clamped so negamax can negate it
+    alpha = std::max(alpha, -std::numeric_limits<int>::max());
+
+    if (isMaximizing)
+        return minmaxNegamax<true>(depth, board, bestMove, initialMoves, alpha, beta, repetitions);
+
+    return -minmaxNegamax<false>(depth, board, bestMove, initialMoves, -beta, -alpha, repetitions);
+}
+
+//victim and attacker values for capture ordering, indexed by piece type
+int mvvLvaValues[7] = {1, 3, 3, 5, 9, 10, 0};
+
+//how often the clock is read, the node counter is checked every node
+const uint64_t CLOCK_CHECK_INTERVAL = 1024;
+
+bool MinMax::SearchContext::shouldStop()
+{
+    if (stopped)
+        return true;
+
+    if (nodeLimit != 0 && nodes >= nodeLimit)
+        stopped = true;
+    else if (nodes % CLOCK_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline)
+        stopped = true;
+
+    return stopped;
+}
+
+//hash move first, then captures that do not lose material by most valuable victim and least valuable attacker, then
+//quiet moves and last the captures that lose the exchange, the biggest losses at the very end
+void orderMoves(const chess::Board& board, chess::Movelist& moves, chess::Move hashMove)
+{
+    for (chess::Move& move : moves)
     {
-        //determine the board score
+        int score = 0;
 
-        int boardScore = 0;
-        boardScore = MinMax::getBoardScore(board);
+        if (move == hashMove)
+        {
+            score = 30000;
+        }
+        else if (board.isCapture(move))
+        {
+            //only the losing captures need the exact exchange, to sort the biggest losses last
+            score = xoxo::seeAtLeast(board, move, 0) ? 10000 + MinMax::getMvvLva(board, move)
+                                                     : -10000 + xoxo::see(board, move);
+        }
 
-        return boardScore;
+        move.setScore(static_cast<int16_t>(score));
     }
 
+    std::sort(moves.begin(), moves.end(), [](const chess::Move& a, const chess::Move& b)
+        { return a.score() > b.score(); });
+}
+
+//most valuable victim and least valuable attacker only, whether a capture loses the exchange is left to the caller
+void orderCaptures(const chess::Board& board, chess::Movelist& captures)
+{
+    for (chess::Move& move : captures)
+        move.setScore(static_cast<int16_t>(MinMax::getMvvLva(board, move)));
+
+    std::sort(captures.begin(), captures.end(), [](const chess::Move& a, const chess::Move& b)
+        { return a.score() > b.score(); });
+}
+
+int MinMax::getMvvLva(const chess::Board& board, chess::Move move)
+{
+    chess::PieceType victim = move.typeOf() == chess::Move::ENPASSANT ? chess::PieceType(chess::PieceType::PAWN) : board.at(move.to()).type();
+    return mvvLvaValues[static_cast<int>(victim)] * 10 - mvvLvaValues[static_cast<int>(board.at(move.from()).type())];
+}
+
+int* pieceSquareTables[6] = {pawnValues, knightValues, bishopValues, rookValues, queenValues, kingValues};
+
+int MinMax::getPieceSquareDelta(const chess::Board& board, chess::Move move)
+{
+    chess::Piece piece = board.at(move.from());
+    const int* table = pieceSquareTables[static_cast<int>(piece.type())];
+
+    //the tables are laid out rank 8 first as white sees the board, so white squares are mirrored into them
+    int flip = piece.color() == chess::Color::WHITE ? 56 : 0;
+    int from = move.from().index();
+    int to = move.to().index();
+
+    //castling is encoded as the king taking its own rook, the king really lands on the g or c file
+    if (move.typeOf() == chess::Move::CASTLING)
+        to = (from & 56) + (to > from ? 6 : 2);
+
+    return table[to ^ flip] - table[from ^ flip];
+}
+
+//mate scores are stored relative to the node so they stay valid wherever the position is reached again
+int scoreToTable(int score, int ply)
+{
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+int scoreFromTable(int score, int ply)
+{
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
+template <chess::Color::underlying Us>
+int MinMax::evaluateFor(chess::Board& board)
+{
+    int score = MinMax::getBoardScore(board);
+
+    if constexpr (Us == chess::Color::WHITE)
+        return score;
+    else
+        return -score;
+}
+
+int MinMax::evaluate(chess::Board& board)
+{
+    return board.sideToMove() == chess::Color::WHITE ? evaluateFor<chess::Color::WHITE>(board) : evaluateFor<chess::Color::BLACK>(board);
+}
+
+template <chess::Color::underlying Us, MinMax::NodeType Type>
+int MinMax::negamax(chess::Board& board, int depth, int ply, int alpha, int beta, SearchContext& context)
+{
+    constexpr chess::Color::underlying Them = Us == chess::Color::WHITE ? chess::Color::BLACK : chess::Color::WHITE;
+    constexpr bool pvNode = Type != NodeType::NON_PV;
+    //the first move of a pv node continues the pv, everything below a non-pv node stays off it
+    constexpr NodeType FirstChild = pvNode ? NodeType::PV : NodeType::NON_PV;
+
+    if (context.shouldStop())
+        return 0;
+
+    context.nodes++;
+
     chess::Movelist moves;
-    chess::movegen::legalmoves(moves, board);
+    {
+        xoxo::PerfScope scope(xoxo::PerfPhase::MOVEGEN);
+        chess::movegen::legalmoves(moves, board);
+    }
 
-    chess::Board tempBoard(board);
-    int evaluation = 0;
+    xoxo::Terminal terminal = xoxo::getTerminal(board, moves, context.repetitions);
 
-    if (isMaximizing)
+    if (terminal == xoxo::Terminal::CHECKMATE)
+        return -MATE_SCORE + ply;
+
+    //the root still has to pick a move when its position is already drawn, by repetition, the fifty move rule or
+    //material, as long as it has one
+    if constexpr (Type == NodeType::ROOT)
     {
-        int maxValue = std::numeric_limits<int>::min();
+        if (moves.empty())
+            return 0;
+    }
+    else if (terminal != xoxo::Terminal::NONE)
+    {
+        return 0;
+    }
+
+    if (depth <= 0)
+        return quiesce<Us>(board, ply, alpha, beta, context);
+
+    xoxo::TranspositionTable& table = xoxo::TranspositionTable::shared();
+    xoxo::TTData entry;
+    chess::Move hashMove = chess::Move::NO_MOVE;
 
-        for (chess::Move move : moves)
+    if (table.probe(board.hash(), entry))
+    {
+        hashMove = entry.move;
+        int score = scoreFromTable(entry.score, ply);
+
+        //pv nodes always search, so the line they return is a real one
+        if (!pvNode && entry.depth >= depth &&
+            (entry.bound == xoxo::Bound::EXACT ||
+             (entry.bound == xoxo::Bound::LOWER && score >= beta) ||
+             (entry.bound == xoxo::Bound::UPPER && score <= alpha)))
         {
-            if(tempBoard.isCapture(move))
-            {
-                evaluation += 400;
-            }
+            return score;
+        }
+    }
+
+    orderMoves(board, moves, hashMove);
 
-            tempBoard.makeMove(move);
+    int originalAlpha = alpha;
+    int bestScore = -MATE_SCORE;
+    chess::Move bestMove = moves[0];
+    bool firstMove = true;
+
+    for (const chess::Move& move : moves)
+    {
+        if (context.repetitions != nullptr)
+            context.repetitions->push(board.hash());
 
-            evaluation = minmaxMove(depth - 1, false, tempBoard, bestMove, initialMoves, alpha, beta);
+        board.makeMove(move);
 
-            auto gameResults = tempBoard.isGameOver();
+        int score;
+        if (firstMove)
+        {
+            score = -negamax<Them, FirstChild>(board, depth - 1, ply + 1, -beta, -alpha, context);
+        }
+        else
+        {
+            //principal variation search: later moves only have to prove they are no better than the first
+            score = -negamax<Them, NodeType::NON_PV>(board, depth - 1, ply + 1, -alpha - 1, -alpha, context);
 
-            if (gameResults.first == chess::GameResultReason::CHECKMATE)
+            if constexpr (pvNode)
             {
-                evaluation += 100000;
+                if (score > alpha && score < beta)
+                    score = -negamax<Them, NodeType::PV>(board, depth - 1, ply + 1, -beta, -alpha, context);
             }
+        }
 
-            if(gameResults.second == chess::GameResult::DRAW)
-            {
-                if (gameResults.first == chess::GameResultReason::THREEFOLD_REPETITION)
-                {
-                    evaluation -= 5000;
-                }
+        board.unmakeMove(move);
+        firstMove = false;
 
-                evaluation -= 5000;
-            }
+        if (context.repetitions != nullptr)
+            context.repetitions->pop();
 
-            maxValue = fmax(maxValue, evaluation);
-            alpha = fmax(alpha, evaluation);
+        if (context.stopped)
+            return 0;
 
-            if (beta <= alpha)
-            {
-                tempBoard.unmakeMove(move);
-                break;
-            }
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestMove = move;
 
-            if (maxValue == evaluation && initialMoves.find(move) != -1)
-            {
-                bestMove = move;
-            }
+            if constexpr (Type == NodeType::ROOT)
+                context.rootMove = move;
+        }
 
-            tempBoard.unmakeMove(move);
+        alpha = std::max(alpha, score);
+
+        if (alpha >= beta)
+        {
+            XOXO_TRACE_EVENT(xoxo::TraceEvent::CUTOFF, board.hash(), move.move(), depth, score,
+                             static_cast<uint32_t>(&move - &moves[0]));
+            break;
         }
+    }
+
+    xoxo::TTData result;
+    result.score = scoreToTable(bestScore, ply);
+    result.depth = depth;
+    result.move = bestMove;
+    result.bound = bestScore >= beta ? xoxo::Bound::LOWER : (bestScore <= originalAlpha ? xoxo::Bound::UPPER : xoxo::Bound::EXACT);
+    table.store(board.hash(), result);
+
+    return bestScore;
+}
 
-        return maxValue;
+int MinMax::alphaBeta(chess::Board& board, int depth, int ply, int alpha, int beta, SearchContext& context)
+{
+    if (board.sideToMove() == chess::Color::WHITE)
+    {
+        return ply == 0 ? negamax<chess::Color::WHITE, NodeType::ROOT>(board, depth, ply, alpha, beta, context)
+                        : negamax<chess::Color::WHITE, NodeType::PV>(board, depth, ply, alpha, beta, context);
     }
-    else
+
+    return ply == 0 ? negamax<chess::Color::BLACK, NodeType::ROOT>(board, depth, ply, alpha, beta, context)
+                    : negamax<chess::Color::BLACK, NodeType::PV>(board, depth, ply, alpha, beta, context);
+}
+
+template <chess::Color::underlying Us>
+int MinMax::quiesce(chess::Board& board, int ply, int alpha, int beta, SearchContext& context)
+{
+    constexpr chess::Color::underlying Them = Us == chess::Color::WHITE ? chess::Color::BLACK : chess::Color::WHITE;
+
+    if (context.shouldStop())
+        return 0;
+
+    context.nodes++;
+
+    int standPat = evaluateFor<Us>(board);
+
+    if (standPat >= beta)
+        return standPat;
+
+    alpha = std::max(alpha, standPat);
+
+    chess::Movelist captures;
     {
-        int minValue = std::numeric_limits<int>::max();
+        xoxo::PerfScope scope(xoxo::PerfPhase::MOVEGEN);
+        chess::movegen::legalmoves<chess::movegen::MoveGenType::CAPTURE>(captures, board);
+    }
+    orderCaptures(board, captures);
 
-        for (chess::Move move : moves)
-        {
-            if(tempBoard.isCapture(move))
-            {
-                evaluation += 400;
-            }
+    for (const chess::Move& move : captures)
+    {
+        //bet that a capture losing the exchange never beats standing pat. tested only once the move is reached, a
+        //beta cutoff spares the rest
+        if (!xoxo::seeAtLeast(board, move, 0))
+            continue;
 
-            tempBoard.makeMove(move);
+        board.makeMove(move);
+        int score = -quiesce<Them>(board, ply + 1, -beta, -alpha, context);
+        board.unmakeMove(move);
 
-            evaluation = minmaxMove(depth - 1, true, tempBoard, bestMove, initialMoves, alpha, beta);
+        if (context.stopped)
+            return 0;
 
-            auto gameResults = tempBoard.isGameOver();
+        if (score >= beta)
+            return score;
 
+        alpha = std::max(alpha, score);
+    }
 
+    return alpha;
+}
 
-            if(gameResults.second == chess::GameResult::DRAW)
-            {
-                if (gameResults.first == chess::GameResultReason::THREEFOLD_REPETITION)
-                {
-                    evaluation += 5000;
-                }
+int MinMax::quiescence(chess::Board& board, int ply, int alpha, int beta, SearchContext& context)
+{
+    return board.sideToMove() == chess::Color::WHITE ? quiesce<chess::Color::WHITE>(board, ply, alpha, beta, context)
+                                                      : quiesce<chess::Color::BLACK>(board, ply, alpha, beta, context);
+}
 
-                evaluation += 5000;
-            }
+int MinMax::searchPosition(chess::Board& board, SearchContext& context, chess::Move& bestMove)
+{
+    //used when not even the first iteration finishes in time
+    int bestScore = MinMax::evaluate(board);
 
-            minValue = fmin(minValue, evaluation);
-            beta = fmin(beta, evaluation);
+    XOXO_TRACE_EVENT(xoxo::TraceEvent::SEARCH_BEGIN, board.hash(), 0, 0, 0, static_cast<uint32_t>(context.maxDepth));
+    xoxo::AllocScope allocations(xoxo::AllocTag::MINMAX);
 
-            if (beta <= alpha)
-            {
-                tempBoard.unmakeMove(move);
-                break;
-            }
+    for (int depth = 1; depth <= context.maxDepth; depth++)
+    {
+        context.rootMove = chess::Move::NO_MOVE;
+        int score = MinMax::alphaBeta(board, depth, 0, -MATE_SCORE, MATE_SCORE, context);
 
-            if (minValue == evaluation && initialMoves.find(move) != -1)
-            {
-                bestMove = move;
-            }
+        if (context.stopped)
+            break;
 
-            tempBoard.unmakeMove(move);
-        }
+        bestScore = score;
+        bestMove = context.rootMove;
+        context.completedDepth = depth;
+        XOXO_TRACE_EVENT(xoxo::TraceEvent::ITERATION, board.hash(), bestMove.move(), depth, score, 0);
 
-        return minValue;
+        if (context.onIteration)
+            context.onIteration(depth, score, bestMove);
+
+        //a mate was found, searching deeper will not change the move
+        if (std::abs(score) >= MATE_BOUND)
+            break;
+    }
+
+    XOXO_TRACE_EVENT(xoxo::TraceEvent::SEARCH_END, board.hash(), bestMove.move(), context.completedDepth, bestScore,
+                     static_cast<uint32_t>(context.nodes));
+    return bestScore;
+}
+
+int MinMax::getTerminalScore(xoxo::Terminal terminal, bool moverWasMaximizing)
+{
+    switch (terminal)
+    {
+        case xoxo::Terminal::CHECKMATE:
+            return moverWasMaximizing ? 100000 : 0;
+        case xoxo::Terminal::REPETITION:
+            return moverWasMaximizing ? -10000 : 10000;
+        case xoxo::Terminal::STALEMATE:
+        case xoxo::Terminal::DRAW:
+            return moverWasMaximizing ? -5000 : 5000;
+        default:
+            return 0;
     }
 }
 
 int MinMax::getBoardScore(chess::Board& board)
 {
+    xoxo::PerfScope scope(xoxo::PerfPhase::EVAL);
+
+    int cachedScore;
+    if(xoxo::EvalCache::minmax().probe(board.hash(), cachedScore))
+        return cachedScore;
+
     //determining the score of the board based on materials
     int materialScore = MinMax::getMaterialScore(board);
+    //where the pieces stand, from the tables chesstune fits
+    int pieceSquareScore = MinMax::getPieceSquareScore(board);
 
-    //check mobility of pieces
-    int mobilityScore = MinMax::getMobilityScore(board);
-
-    //4. king safety
-    int kingSafety = MinMax::getKingSafety(board);
+    //mobility (getMobilityScore) and king safety (getKingSafety) are not part of the score, so they are not computed
+    //on every node just to be thrown away
 
     //5.compare pawn structure
+    int pawnStructure = MinMax::getPawnStructure(board);
+
+    int boardScore = materialScore + pieceSquareScore + pawnStructure;// + mobilityScore + kingSafety;
+    xoxo::EvalCache::minmax().store(board.hash(), boardScore);
 
-    return materialScore;// + mobilityScore + kingSafety;
+    return boardScore;
+}
+
+int MinMax::getPawnStructure(const chess::Board& board)
+{
+    //the structure part only changes on pawn moves, so it comes out of the pawn hash almost every time
+    return xoxo::PawnHashTable::local().probe(board) + xoxo::evaluatePawnShield(board);
 }
 
 int MinMax::getMaterialScore(const chess::Board& board)
@@ -216,224 +476,118 @@ int MinMax::getMaterialScore(const chess::Board& board)
     int materialScore = 0;
 
     materialScore += 99999 * (board.pieces(chess::PieceType::KING, chess::Color::WHITE).count() - board.pieces(chess::PieceType::KING, chess::Color::BLACK).count());
-    materialScore += 900 * (board.pieces(chess::PieceType::QUEEN, chess::Color::WHITE).count() - board.pieces(chess::PieceType::QUEEN, chess::Color::BLACK).count());
-    materialScore += 500 * (board.pieces(chess::PieceType::ROOK, chess::Color::WHITE).count() - board.pieces(chess::PieceType::ROOK, chess::Color::BLACK).count());
-    materialScore += 330 * (board.pieces(chess::PieceType::BISHOP, chess::Color::WHITE).count() - board.pieces(chess::PieceType::BISHOP, chess::Color::BLACK).count());
-    materialScore += 320 * (board.pieces(chess::PieceType::KNIGHT, chess::Color::WHITE).count() - board.pieces(chess::PieceType::KNIGHT, chess::Color::BLACK).count());
-    materialScore += 100 * (board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).count() - board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).count());
+
+    for(int type = 0; type < 5; type++)
+    {
+        chess::PieceType pieceType = static_cast<chess::PieceType::underlying>(type);
+        materialScore += materialValues[type] * (board.pieces(pieceType, chess::Color::WHITE).count() - board.pieces(pieceType, chess::Color::BLACK).count());
+    }
 
     return materialScore;
 }
 
-int MinMax::getMobilityScore(const chess::Board& board)
+int MinMax::getPieceSquareScore(const chess::Board& board)
 {
-    int mobilityScore = 0;
+    int pieceSquareScore = 0;
 
-    if (board.sideToMove() == chess::Color::BLACK)
+    for(int type = 0; type < 6; type++)
     {
-        if(board.isAttacked(chess::Square(board.kingSq(chess::Color::WHITE)), chess::Color::BLACK))
-        {
-            mobilityScore += 500;
-        }
+        chess::PieceType pieceType = static_cast<chess::PieceType::underlying>(type);
+        const int* table = pieceSquareTables[type];
+
+        //same mirroring as getPieceSquareDelta, black squares are already in table order
+        for(uint64_t bits = board.pieces(pieceType, chess::Color::WHITE).getBits(); bits != 0; bits &= bits - 1)
+            pieceSquareScore += table[std::countr_zero(bits) ^ 56];
+        for(uint64_t bits = board.pieces(pieceType, chess::Color::BLACK).getBits(); bits != 0; bits &= bits - 1)
+            pieceSquareScore -= table[std::countr_zero(bits)];
+    }
 
-        for (int x = 0; x < 8; x++)
-        {
-            for (int y = 0; y < 8; y++)
-            {
-                int index = y + (x << 3);
+    return pieceSquareScore;
+}
 
-                if (chess::Piece piece = board.at(chess::Square(index)); piece != chess::Piece::NONE)
-                {
-                    switch (piece)
-                    {
-                        case 0:
-                            mobilityScore += pawnValues[index];
-
-                            if ((x >= 3 && x <= 4) && (y >= 3 && y <= 4))
-                            {
-                                mobilityScore += 10;
-                            }
-
-                            break;
-                        case 1:
-                            mobilityScore += knightValues[index];
-
-                            if ((x >= 2 && x <= 5) && (y >= 2 && y <= 5))
-                            {
-                                mobilityScore += 20;
-                            }
-
-                            break;
-                        case 2:
-                            mobilityScore += bishopValues[index];
-
-                            if ((x >= 2 && x <= 5) && (y >= 2 && y <= 5))
-                            {
-                                mobilityScore += 30;
-                            }
-
-                            break;
-                        case 3:
-                            mobilityScore += rookValues[index];
-                            break;
-                        case 4:
-                            mobilityScore += queenValues[index];
-                            break;
-                        case 5:
-                            mobilityScore += kingValues[index];
-                            break;
-                        default:
-                            break;
-                    }
-                }
-            }
-        }
-    }
-    else
+//d4, e4, d5 and e5, and the c3-f6 block; both read the same from either side so they need no flip
+const uint64_t CENTRE_SQUARES = 0x0000001818000000ULL;
+const uint64_t EXTENDED_CENTRE = 0x00003C3C3C3C0000ULL;
+
+template <chess::Color::underlying Us>
+int MinMax::mobilityFor(const chess::Board& board)
+{
+    constexpr chess::Color::underlying Them = Us == chess::Color::WHITE ? chess::Color::BLACK : chess::Color::WHITE;
+    //the tables are laid out as white sees the board from rank 8 down, the mirroring is fixed for each side
+    constexpr int Flip = Us == chess::Color::WHITE ? 56 : 0;
+    int mobilityScore = 0;
+
+    if(board.isAttacked(chess::Square(board.kingSq(Them)), Us))
     {
-        if(board.isAttacked(chess::Square(board.kingSq(chess::Color::BLACK)), chess::Color::WHITE))
-        {
-            mobilityScore += 500;
-        }
+        mobilityScore += 500;
+    }
 
-        for (int x = 7; x >= 0; x--)
-        {
-            for (int y = 7; y >= 0; y--)
-            {
-                int index = y + (x << 3);
+    for(int type = 0; type < 6; type++)
+    {
+        const int* table = pieceSquareTables[type];
+        uint64_t pieces = board.pieces(static_cast<chess::PieceType::underlying>(type), Us).getBits();
 
-                if (chess::Piece piece = board.at(chess::Square(index)); piece != chess::Piece::NONE)
-                {
-                    switch (piece)
-                    {
-                        case 0:
-                            mobilityScore += pawnValues[index];
-
-                            if ((x >= 3 && x <= 4) && (y >= 3 && y <= 4))
-                            {
-                                mobilityScore += 10;
-                            }
-
-                            break;
-                        case 1:
-                            mobilityScore += knightValues[index];
-
-                            if ((x >= 2 && x <= 5) && (y >= 2 && y <= 5))
-                            {
-                                mobilityScore += 20;
-                            }
-
-                            break;
-                        case 2:
-                            mobilityScore += bishopValues[index];
-
-                            if ((x >= 2 && x <= 5) && (y >= 2 && y <= 5))
-                            {
-                                mobilityScore += 30;
-                            }
-
-                            break;
-                        case 3:
-                            mobilityScore += rookValues[index];
-                            break;
-                        case 4:
-                            mobilityScore += queenValues[index];
-                            break;
-                        case 5:
-                            mobilityScore += kingValues[index];
-                            break;
-                        default:
-                            break;
-                    }
-                }
-            }
-        }
+        for(uint64_t bits = pieces; bits != 0; bits &= bits - 1)
+            mobilityScore += table[std::countr_zero(bits) ^ Flip];
     }
 
+    mobilityScore += 10 * std::popcount(board.pieces(chess::PieceType::PAWN, Us).getBits() & CENTRE_SQUARES);
+    mobilityScore += 20 * std::popcount(board.pieces(chess::PieceType::KNIGHT, Us).getBits() & EXTENDED_CENTRE);
+    mobilityScore += 30 * std::popcount(board.pieces(chess::PieceType::BISHOP, Us).getBits() & EXTENDED_CENTRE);
 
     return mobilityScore;
 }
 
-int kingSafetySquares[8] = {0, 0, 50, 75, 88, 94, 97, 99};
+int MinMax::getMobilityScore(const chess::Board& board)
+{
+    return board.sideToMove() == chess::Color::WHITE ? mobilityFor<chess::Color::WHITE>(board) : mobilityFor<chess::Color::BLACK>(board);
+}
 
-int MinMax::getKingSafety(const chess::Board& board)
+template <chess::Color::underlying Us>
+int MinMax::kingSafetyFor(const chess::Board& board)
 {
+    constexpr chess::Color::underlying Them = Us == chess::Color::WHITE ? chess::Color::BLACK : chess::Color::WHITE;
     int kingSafetyScore = 0;
-    chess::Color white = chess::Color::WHITE;
-    chess::Color black = chess::Color::BLACK;
-    chess::Square whiteKingSquare = board.kingSq(white);
-    chess::Square blackKingSquare = board.kingSq(black);
+    chess::Square kingSquare = board.kingSq(Us);
 
-    if (board.sideToMove() == chess::Color::BLACK)
+    if(chess::Square::back_rank(kingSquare, Us))
     {
-        if(chess::Square::back_rank(blackKingSquare, black))
-        {
-            kingSafetyScore += 50;
-        }
-
-        if(board.inCheck())
-        {
-            kingSafetyScore -= 250;
-        }
-
-        int squaresAttacked = 0;
+        kingSafetyScore += 50;
+    }
 
-        for(int x = -1; x <= 1; x++)
-        {
-            for(int y = -1; y <= 1; y++)
-            {
-                chess::File file = blackKingSquare.file() + y;
-                chess::Rank rank = blackKingSquare.rank() + x;
+    if(board.inCheck())
+    {
+        kingSafetyScore -= 250;
+    }
 
-                if(chess::Square::is_valid(rank, file))
-                {
-                    chess::Square square = chess::Square(file, rank);
-                    if(board.isAttacked(square, white))
-                    {
-                        if(square == blackKingSquare)
-                            kingSafetyScore -= 100;
-                        squaresAttacked++;
-                    }
-                }
-            }
-        }
+    int squaresAttacked = 0;
 
-        kingSafetyScore -= kingSafetySquares[squaresAttacked];
-    }
-    else
+    for(int x = -1; x <= 1; x++)
     {
-        if(chess::Square::back_rank(whiteKingSquare, white))
+        for(int y = -1; y <= 1; y++)
         {
-            kingSafetyScore += 50;
-        }
-
-        if(board.inCheck())
-        {
-            kingSafetyScore -= 250;
-        }
+            chess::File file = kingSquare.file() + y;
+            chess::Rank rank = kingSquare.rank() + x;
 
-        int squaresAttacked = 0;
-
-        for(int x = -1; x <= 1; x++)
-        {
-            for(int y = -1; y <= 1; y++)
+            if(chess::Square::is_valid(rank, file))
             {
-                chess::File file = whiteKingSquare.file() + y;
-                chess::Rank rank = whiteKingSquare.rank() + x;
-
-                if(chess::Square::is_valid(rank, file))
+                chess::Square square = chess::Square(file, rank);
+                if(board.isAttacked(square, Them))
                 {
-                    chess::Square square = chess::Square(file, rank);
-                    if(board.isAttacked(square, black))
-                    {
-                        squaresAttacked++;
-                    }
+                    if(square == kingSquare)
+                        kingSafetyScore -= 100;
+                    squaresAttacked++;
                 }
             }
         }
-
-        kingSafetyScore -= kingSafetySquares[squaresAttacked];
     }
 
+    kingSafetyScore -= kingSafetySquares[squaresAttacked];
+
     return kingSafetyScore;
-}
\ No newline at end of file
+}
+
+int MinMax::getKingSafety(const chess::Board& board)
+{
+    return board.sideToMove() == chess::Color::WHITE ? kingSafetyFor<chess::Color::WHITE>(board) : kingSafetyFor<chess::Color::BLACK>(board);
+}
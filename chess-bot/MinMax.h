@@ -6,16 +6,89 @@
 #define CHESS_MINMAX_H
 
 
+#include <chrono>
+#include <functional>
 #include "chess.hpp"
+#include "Terminal.h"
+
+const int MATE_SCORE = 1000000;
+//any score beyond this is a mate found at some distance
+const int MATE_BOUND = MATE_SCORE - 1000;
 
 class MinMax {
 public:
+    //budget and bookkeeping of one alpha-beta search
+    struct SearchContext {
+        int maxDepth = 64;
+        //0 means no node limit
+        uint64_t nodeLimit = 0;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        xoxo::RepetitionStack* repetitions = nullptr;
+
+        uint64_t nodes = 0;
+        int completedDepth = 0;
+        bool stopped = false;
+        //best root move of the iteration in progress
+        chess::Move rootMove = chess::Move::NO_MOVE;
+        //called by searchPosition after every finished iteration with its depth, score and best move
+        std::function<void(int, int, chess::Move)> onIteration;
+
+        bool shouldStop();
+    };
+
     static int getBoardScore(chess::Board& board);
     static int getMaterialScore(const chess::Board& board);
+    //piece-square tables of both sides, white's point of view
+    static int getPieceSquareScore(const chess::Board& board);
     static int getMobilityScore(const chess::Board& board);
     static int getKingSafety(const chess::Board& board);
+    static int getPawnStructure(const chess::Board& board);
+    //gain of the moving piece on its piece-square table
+    static int getPieceSquareDelta(const chess::Board& board, chess::Move move);
+    //most valuable victim, least valuable attacker ordering key of a capture
+    static int getMvvLva(const chess::Board& board, chess::Move move);
+    //score adjustment for the side that just moved into a finished game
+    static int getTerminalScore(xoxo::Terminal terminal, bool moverWasMaximizing);
     static int minmaxMove(int depth, bool isMaximizing, chess::Board& board, chess::Move& bestMove, const chess::Movelist& initialMoves,
-                   int alpha = std::numeric_limits<int>::min(), int beta = std::numeric_limits<int>::max());
+                   int alpha = std::numeric_limits<int>::min(), int beta = std::numeric_limits<int>::max(),
+                   xoxo::RepetitionStack* repetitions = nullptr);
+
+    //getBoardScore from the side to move's point of view
+    static int evaluate(chess::Board& board);
+    //negamax alpha-beta on the shared transposition table, scores are from the side to move's point of view
+    static int alphaBeta(chess::Board& board, int depth, int ply, int alpha, int beta, SearchContext& context);
+    static int quiescence(chess::Board& board, int ply, int alpha, int beta, SearchContext& context);
+    //iterative deepening until maxDepth or the budget runs out, returns the score of the deepest finished iteration
+    static int searchPosition(chess::Board& board, SearchContext& context, chess::Move& bestMove);
+
+private:
+    //where a node sits in the principal variation search
+    enum class NodeType {
+        ROOT,
+        //on the expected best line, searched with a full window
+        PV,
+        //only has to prove it is no better than the line so far, searched with a null window
+        NON_PV
+    };
+
+    //the specialisations below are only instantiated in MinMax.cpp, everything outside goes through the dispatchers above
+
+    //the side to move known at compile time, getMobilityScore and getKingSafety dispatch to these
+    template <chess::Color::underlying Us>
+    static int mobilityFor(const chess::Board& board);
+    template <chess::Color::underlying Us>
+    static int kingSafetyFor(const chess::Board& board);
+    //minmaxMove as negamax, scores are from the point of view of the side Maximizing says is to move
+    template <bool Maximizing>
+    static int minmaxNegamax(int depth, chess::Board& board, chess::Move& bestMove, const chess::Movelist& initialMoves, int alpha, int beta,
+                             xoxo::RepetitionStack* repetitions);
+    template <chess::Color::underlying Us>
+    static int evaluateFor(chess::Board& board);
+    //alphaBeta and quiescence with the side to move and the node type fixed at compile time, Us must be to move
+    template <chess::Color::underlying Us, NodeType Type>
+    static int negamax(chess::Board& board, int depth, int ply, int alpha, int beta, SearchContext& context);
+    template <chess::Color::underlying Us>
+    static int quiesce(chess::Board& board, int ply, int alpha, int beta, SearchContext& context);
 };
 
 
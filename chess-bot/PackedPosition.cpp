@@ -0,0 +1,226 @@
+#include "PackedPosition.h"
+#include <algorithm>
+#include <bit>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define XOXO_HAS_MMAP 1
+#endif
+
+namespace xoxo {
+
+    //indexed by chess::Piece value
+    const char PIECE_CHARS[] = "PNBRQKpnbrqk";
+    const char CASTLING_CHARS[] = "KQkq";
+
+    PackedPosition packPosition(const chess::Board& board, int score, int result)
+    {
+        PackedPosition position;
+        position.occupancy = board.occ().getBits();
+
+        int nibble = 0;
+        for(uint64_t bits = position.occupancy; bits != 0; bits &= bits - 1, nibble++)
+        {
+            int square = std::countr_zero(bits);
+            uint8_t piece = static_cast<uint8_t>(static_cast<int>(board.at(chess::Square(square))));
+            position.pieces[nibble / 2] |= piece << (nibble % 2 * 4);
+        }
+
+        position.score = static_cast<int16_t>(std::clamp(score, -32000, 32000));
+        position.result = static_cast<int8_t>(result);
+        position.flags = board.sideToMove() == chess::Color::BLACK ? 1 : 0;
+
+        //in CASTLING_CHARS order, white before black and king side before queen side
+        const chess::Board::CastlingRights rights = board.castlingRights();
+        for(int i = 0; i < 4; i++)
+        {
+            chess::Color color = i < 2 ? chess::Color::WHITE : chess::Color::BLACK;
+            auto side = i % 2 == 0 ? chess::Board::CastlingRights::Side::KING_SIDE
+                                   : chess::Board::CastlingRights::Side::QUEEN_SIDE;
+            if(rights.has(color, side))
+                position.flags |= 1 << (i + 1);
+        }
+
+        chess::Square enPassant = board.enpassantSq();
+        position.enPassant = enPassant.index() < 64 ? static_cast<uint8_t>(enPassant.index()) : 64;
+        position.halfMoveClock = static_cast<uint8_t>(std::min<uint32_t>(board.halfMoveClock(), 255));
+        position.fullMoveNumber = static_cast<uint16_t>(std::min<uint32_t>(board.fullMoveNumber(), 65535));
+
+        return position;
+    }
+
+    std::string unpackFen(const PackedPosition& position)
+    {
+        char squares[64];
+        std::fill(squares, squares + 64, 0);
+
+        int nibble = 0;
+        for(uint64_t bits = position.occupancy; bits != 0; bits &= bits - 1, nibble++)
+        {
+            int piece = (position.pieces[nibble / 2] >> (nibble % 2 * 4)) & 0xF;
+            squares[std::countr_zero(bits)] = PIECE_CHARS[std::min(piece, 11)];
+        }
+
+        std::string fen;
+        for(int rank = 7; rank >= 0; rank--)
+        {
+            int empty = 0;
+            for(int file = 0; file < 8; file++)
+            {
+                char piece = squares[rank * 8 + file];
+                if(piece == 0)
+                {
+                    empty++;
+                    continue;
+                }
+
+                if(empty > 0)
+                    fen += static_cast<char>('0' + empty);
+                empty = 0;
+                fen += piece;
+            }
+
+            if(empty > 0)
+                fen += static_cast<char>('0' + empty);
+            if(rank > 0)
+                fen += '/';
+        }
+
+        fen += position.flags & 1 ? " b " : " w ";
+
+        std::string castling;
+        for(int i = 0; i < 4; i++)
+        {
+            if(position.flags & (1 << (i + 1)))
+                castling += CASTLING_CHARS[i];
+        }
+        fen += castling.empty() ? "-" : castling;
+
+        if(position.enPassant < 64)
+        {
+            fen += ' ';
+            fen += static_cast<char>('a' + position.enPassant % 8);
+            fen += static_cast<char>('1' + position.enPassant / 8);
+        }
+        else
+        {
+            fen += " -";
+        }
+
+        fen += " " + std::to_string(position.halfMoveClock) + " " + std::to_string(position.fullMoveNumber);
+        return fen;
+    }
+
+    PackedPositionWriter::PackedPositionWriter(const std::string& path)
+    {
+        file = std::fopen(path.c_str(), "ab");
+    }
+
+    PackedPositionWriter::~PackedPositionWriter()
+    {
+        if(file != nullptr)
+            std::fclose(file);
+    }
+
+    void PackedPositionWriter::append(const PackedPosition* positions, size_t count)
+    {
+        if(file == nullptr || count == 0)
+            return;
+
+        std::lock_guard lock(mutex);
+        records += std::fwrite(positions, sizeof(PackedPosition), count, file);
+    }
+
+    uint64_t PackedPositionWriter::written() const
+    {
+        std::lock_guard lock(mutex);
+        return records;
+    }
+
+    PackedPositionBuffer::PackedPositionBuffer(PackedPositionWriter& writer, size_t capacity)
+        : writer(writer), capacity(std::max<size_t>(1, capacity))
+    {
+        buffer.reserve(this->capacity);
+    }
+
+    void PackedPositionBuffer::push(const PackedPosition& position)
+    {
+        buffer.push_back(position);
+
+        if(buffer.size() >= capacity)
+            flush();
+    }
+
+    void PackedPositionBuffer::flush()
+    {
+        writer.append(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+    PackedPositionFile::PackedPositionFile(const std::string& path, FileAccess access)
+    {
+#ifdef XOXO_HAS_MMAP
+        int descriptor = open(path.c_str(), O_RDONLY);
+        if(descriptor >= 0)
+        {
+            struct stat info;
+            if(fstat(descriptor, &info) == 0)
+            {
+                opened = true;
+                count = static_cast<size_t>(info.st_size) / sizeof(PackedPosition);
+
+                if(count > 0)
+                {
+                    mappingSize = count * sizeof(PackedPosition);
+                    void* memory = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+                    if(memory != MAP_FAILED)
+                    {
+                        //read ahead helps full passes and only wastes io for samplers jumping around the file
+                        madvise(memory, mappingSize, access == FileAccess::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+                        mapping = memory;
+                        records = static_cast<const PackedPosition*>(memory);
+                    }
+                }
+            }
+
+            close(descriptor);
+        }
+
+        if(records != nullptr || (opened && count == 0))
+            return;
+#else
+        (void)access;
+#endif
+
+        //no mmap, or it failed: load the whole file
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if(file == nullptr)
+        {
+            opened = false;
+            count = 0;
+            return;
+        }
+
+        PackedPosition record;
+        while(std::fread(&record, sizeof(PackedPosition), 1, file) == 1)
+            loaded.push_back(record);
+
+        std::fclose(file);
+        opened = true;
+        count = loaded.size();
+        records = loaded.data();
+    }
+
+    PackedPositionFile::~PackedPositionFile()
+    {
+#ifdef XOXO_HAS_MMAP
+        if(mapping != nullptr)
+            munmap(mapping, mappingSize);
+#endif
+    }
+
+} // xoxo
@@ -0,0 +1,102 @@
+#ifndef CHESS_PACKEDPOSITION_H
+#define CHESS_PACKEDPOSITION_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "chess.hpp"
+
+namespace xoxo {
+
+    //one training position in 32 bytes, written and read as raw records
+    struct PackedPosition {
+        uint64_t occupancy = 0;
+        //one nibble per occupied square in ascending square order, low nibble first, chess::Piece values
+        uint8_t pieces[16] = {};
+        //search score in centipawns from white's point of view
+        int16_t score = 0;
+        //bit 0 black to move, bits 1 to 4 castling rights K, Q, k, q
+        uint8_t flags = 0;
+        //64 when there is no en passant square
+        uint8_t enPassant = 64;
+        uint8_t halfMoveClock = 0;
+        //game result from white's point of view: 1 white won, 0 draw, -1 black won
+        int8_t result = 0;
+        uint16_t fullMoveNumber = 1;
+    };
+
+    static_assert(sizeof(PackedPosition) == 32, "records are read and written as raw 32 byte blocks");
+
+    PackedPosition packPosition(const chess::Board& board, int score, int result);
+    std::string unpackFen(const PackedPosition& position);
+
+    //appends records to one file for any number of threads, each thread batches through a PackedPositionBuffer
+    class PackedPositionWriter {
+    public:
+        explicit PackedPositionWriter(const std::string& path);
+        ~PackedPositionWriter();
+        PackedPositionWriter(const PackedPositionWriter&) = delete;
+        PackedPositionWriter& operator=(const PackedPositionWriter&) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+        void append(const PackedPosition* records, size_t count);
+        uint64_t written() const;
+
+    private:
+        FILE* file = nullptr;
+        mutable std::mutex mutex;
+        uint64_t records = 0;
+    };
+
+    //a thread's write buffer, hands full blocks to the writer so the lock is taken once per block
+    class PackedPositionBuffer {
+    public:
+        explicit PackedPositionBuffer(PackedPositionWriter& writer, size_t capacity = 1 << 15);
+        ~PackedPositionBuffer() { flush(); }
+        PackedPositionBuffer(const PackedPositionBuffer&) = delete;
+        PackedPositionBuffer& operator=(const PackedPositionBuffer&) = delete;
+
+        void push(const PackedPosition& position);
+        void flush();
+
+    private:
+        PackedPositionWriter& writer;
+        std::vector<PackedPosition> buffer;
+        size_t capacity;
+    };
+
+    //how a PackedPositionFile will be read, passed on to the kernel as a paging hint
+    enum class FileAccess {
+        RANDOM,
+        SEQUENTIAL
+    };
+
+    //read only view of a record file, memory mapped where the system allows it so sampling touches only the
+    //records it reads, otherwise loaded whole
+    class PackedPositionFile {
+    public:
+        explicit PackedPositionFile(const std::string& path, FileAccess access = FileAccess::RANDOM);
+        ~PackedPositionFile();
+        PackedPositionFile(const PackedPositionFile&) = delete;
+        PackedPositionFile& operator=(const PackedPositionFile&) = delete;
+
+        bool isOpen() const { return opened; }
+        size_t size() const { return count; }
+        const PackedPosition* data() const { return records; }
+        const PackedPosition& operator[](size_t index) const { return records[index]; }
+
+    private:
+        const PackedPosition* records = nullptr;
+        size_t count = 0;
+        bool opened = false;
+        //set when records points into a mapping rather than into loaded
+        void* mapping = nullptr;
+        size_t mappingSize = 0;
+        std::vector<PackedPosition> loaded;
+    };
+
+} // xoxo
+
+#endif //CHESS_PACKEDPOSITION_H
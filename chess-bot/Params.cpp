@@ -0,0 +1,65 @@
+#include "Params.h"
+#include <algorithm>
+
+namespace xoxo {
+
+    const ParamInfo PARAM_INFO[PARAM_COUNT] = {
+        {"RAVE_EQUIVALENCE", 500, 1, 10000, 100},
+        {"UCB_EXPLORATION", 2.0, 0.1, 5.0, 0.3},
+        {"PUCT_EXPLORATION", 1.5, 0.1, 5.0, 0.25},
+        {"DEFAULT_VALUE", -0.3, -1.0, 1.0, 0.1},
+    };
+
+    //null until a ScopedParams binds a set to the thread
+    thread_local const ParamSet* threadParams = nullptr;
+
+    const ParamInfo& paramInfo(Param param)
+    {
+        return PARAM_INFO[static_cast<int>(param)];
+    }
+
+    Param findParam(const std::string& name)
+    {
+        for(int i = 0; i < PARAM_COUNT; i++)
+        {
+            if(name == PARAM_INFO[i].name)
+                return static_cast<Param>(i);
+        }
+
+        return Param::COUNT;
+    }
+
+    ParamSet::ParamSet()
+    {
+        for(int i = 0; i < PARAM_COUNT; i++)
+            values[i] = PARAM_INFO[i].defaultValue;
+    }
+
+    void ParamSet::set(Param param, double value)
+    {
+        const ParamInfo& info = paramInfo(param);
+        values[static_cast<int>(param)] = std::clamp(value, info.min, info.max);
+    }
+
+    ParamSet& globalParams()
+    {
+        static ParamSet params;
+        return params;
+    }
+
+    const ParamSet& activeParams()
+    {
+        return threadParams != nullptr ? *threadParams : globalParams();
+    }
+
+    ScopedParams::ScopedParams(const ParamSet& set) : previous(threadParams)
+    {
+        threadParams = &set;
+    }
+
+    ScopedParams::~ScopedParams()
+    {
+        threadParams = previous;
+    }
+
+} // xoxo
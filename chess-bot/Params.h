@@ -0,0 +1,70 @@
+#ifndef CHESS_PARAMS_H
+#define CHESS_PARAMS_H
+
+#include <string>
+
+namespace xoxo {
+
+    //search constants that can be changed at runtime, the searches read them through param(). only constants a
+    //search actually reads belong here, a tuner has nothing to measure on the others
+    enum class Param : int {
+        //edge visits at which UCB1 trusts its own value and the all-moves-as-first value about equally
+        RAVE_EQUIVALENCE,
+        UCB_EXPLORATION,
+        PUCT_EXPLORATION,
+        //value of a drawn playout on the [-1, 1] scale
+        DEFAULT_VALUE,
+        COUNT
+    };
+
+    const int PARAM_COUNT = static_cast<int>(Param::COUNT);
+
+    struct ParamInfo {
+        const char* name;
+        double defaultValue;
+        double min;
+        double max;
+        //perturbation tuners start from, about the change expected to make a measurable difference
+        double step;
+    };
+
+    const ParamInfo& paramInfo(Param param);
+    //Param::COUNT when no parameter has that name
+    Param findParam(const std::string& name);
+
+    //one value for every parameter, starting at the defaults
+    class ParamSet {
+    public:
+        ParamSet();
+
+        double operator[](Param param) const { return values[static_cast<int>(param)]; }
+        //clamped to the parameter's range
+        void set(Param param, double value);
+
+    private:
+        double values[PARAM_COUNT];
+    };
+
+    //the set every thread reads unless it has a ScopedParams of its own
+    ParamSet& globalParams();
+    //the set the calling thread's searches read
+    const ParamSet& activeParams();
+
+    inline double param(Param param) { return activeParams()[param]; }
+
+    //makes set the calling thread's parameters while it lives, so searches with different parameters can run on
+    //different threads at the same time
+    class ScopedParams {
+    public:
+        explicit ScopedParams(const ParamSet& set);
+        ~ScopedParams();
+        ScopedParams(const ScopedParams&) = delete;
+        ScopedParams& operator=(const ScopedParams&) = delete;
+
+    private:
+        const ParamSet* previous;
+    };
+
+} // xoxo
+
+#endif //CHESS_PARAMS_H
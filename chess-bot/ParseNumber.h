@@ -0,0 +1,28 @@
+#ifndef CHESS_PARSENUMBER_H
+#define CHESS_PARSENUMBER_H
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+namespace xoxo {
+
+    //reads the whole of text as a number of value's type, for command line flags. false and value untouched when
+    //text is empty, has anything after the number or does not fit, where std::stoi would throw or read a prefix
+    template <typename T>
+    bool parseNumber(std::string_view text, T& value)
+    {
+        T parsed{};
+        const char* end = text.data() + text.size();
+        auto [last, error] = std::from_chars(text.data(), end, parsed);
+
+        if(text.empty() || error != std::errc() || last != end)
+            return false;
+
+        value = parsed;
+        return true;
+    }
+
+} // xoxo
+
+#endif //CHESS_PARSENUMBER_H
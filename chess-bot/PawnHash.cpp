@@ -0,0 +1,195 @@
+#include "PawnHash.h"
+#include "EngineMemory.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+
+namespace xoxo {
+
+    const uint64_t FILE_A = 0x0101010101010101ULL;
+    const uint64_t FILE_H = FILE_A << 7;
+
+    //splitmix64's finaliser, a bijection that spreads every input bit over the whole word
+    constexpr uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    const uint64_t BLACK_PAWNS_SEED = 0x5EED5EED5EED5EEDULL;
+
+    constexpr uint64_t fileMask(int file)
+    {
+        return FILE_A << file;
+    }
+
+    constexpr uint64_t adjacentFiles(int file)
+    {
+        return (file > 0 ? fileMask(file - 1) : 0) | (file < 7 ? fileMask(file + 1) : 0);
+    }
+
+    constexpr uint64_t rankMask(int rank)
+    {
+        return 0xFFULL << (8 * rank);
+    }
+
+    //every rank in front of the given rank, seen from white (up the board) or black (down the board)
+    constexpr uint64_t forwardRanks(bool white, int rank)
+    {
+        if(white)
+            return rank < 7 ? ~0ULL << (8 * (rank + 1)) : 0;
+
+        return rank > 0 ? ~0ULL >> (8 * (8 - rank)) : 0;
+    }
+
+    uint64_t pawnKey(const chess::Board& board)
+    {
+        uint64_t white = board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).getBits();
+        uint64_t black = board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).getBits();
+
+        //both pawn sets hashed whole: four multiplies whatever the pawn count, where a zobrist key built square by
+        //square costs a table load per pawn and keeping one up to date costs the search work on every move
+        return mix(white ^ mix(black ^ BLACK_PAWNS_SEED));
+    }
+
+    int evaluateSide(bool white, uint64_t ours, uint64_t theirs)
+    {
+        int score = 0;
+
+        uint64_t theirAttacks = white
+                ? ((theirs >> 7) & ~FILE_A) | ((theirs >> 9) & ~FILE_H)
+                : ((theirs << 7) & ~FILE_H) | ((theirs << 9) & ~FILE_A);
+
+        for(int file = 0; file < 8; file++)
+        {
+            int onFile = std::popcount(ours & fileMask(file));
+
+            if(onFile > 1)
+                score -= DOUBLED_PAWN_PENALTY * (onFile - 1);
+        }
+
+        for(uint64_t pawns = ours; pawns; pawns &= pawns - 1)
+        {
+            int sq = std::countr_zero(pawns);
+            int file = sq & 7;
+            int rank = sq >> 3;
+            uint64_t front = forwardRanks(white, rank);
+
+            if((theirs & front & (fileMask(file) | adjacentFiles(file))) == 0)
+            {
+                score += PASSED_PAWN_BONUS[white ? rank : 7 - rank];
+            }
+
+            if((ours & adjacentFiles(file)) == 0)
+            {
+                score -= ISOLATED_PAWN_PENALTY;
+                continue;
+            }
+
+            //nothing beside or behind it can defend the square it wants to move to
+            uint64_t stopSquare = white ? 1ULL << (sq + 8) : 1ULL << (sq - 8);
+
+            if((ours & adjacentFiles(file) & ~front) == 0 && (theirAttacks & stopSquare))
+            {
+                score -= BACKWARD_PAWN_PENALTY;
+            }
+        }
+
+        return score;
+    }
+
+    int evaluatePawns(uint64_t whitePawns, uint64_t blackPawns)
+    {
+        return evaluateSide(true, whitePawns, blackPawns) - evaluateSide(false, blackPawns, whitePawns);
+    }
+
+    int shieldScore(bool white, chess::Square king, uint64_t ours)
+    {
+        int file = king.index() & 7;
+        int rank = king.index() >> 3;
+
+        //a king that already left its first two ranks has no shield worth counting
+        if(white ? rank > 1 : rank < 6)
+            return 0;
+
+        uint64_t files = fileMask(file) | adjacentFiles(file);
+        int direction = white ? 1 : -1;
+
+        return SHIELD_NEAR_BONUS * std::popcount(ours & files & rankMask(rank + direction)) +
+               SHIELD_FAR_BONUS * std::popcount(ours & files & rankMask(rank + 2 * direction));
+    }
+
+    int evaluatePawnShield(const chess::Board& board)
+    {
+        uint64_t white = board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).getBits();
+        uint64_t black = board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).getBits();
+
+        return shieldScore(true, board.kingSq(chess::Color::WHITE), white) -
+               shieldScore(false, board.kingSq(chess::Color::BLACK), black);
+    }
+
+    PawnHashTable::PawnHashTable(int entries)
+    {
+        //round down to a power of two so the index is a mask
+        uint64_t size = std::bit_floor(static_cast<uint64_t>(entries > 0 ? entries : 1));
+        void* block = EngineMemory::global().allocateReserved(size * sizeof(PawnEntry), MemoryTag::PAWN_HASH);
+
+        //no room in the budget, a single entry still saves the work for a position repeating its pawns
+        if(block == nullptr)
+        {
+            table = &fallback;
+            mask = 0;
+            return;
+        }
+
+        table = static_cast<PawnEntry*>(block);
+        std::uninitialized_value_construct_n(table, size);
+        mask = size - 1;
+    }
+
+    PawnHashTable::~PawnHashTable()
+    {
+        if(table != &fallback)
+            EngineMemory::global().release(table, (mask + 1) * sizeof(PawnEntry), MemoryTag::PAWN_HASH);
+    }
+
+    int PawnHashTable::probe(const chess::Board& board)
+    {
+        uint64_t key = pawnKey(board);
+        PawnEntry& entry = table[key & mask];
+
+        probes++;
+
+        if(entry.key == key)
+        {
+            hits++;
+            return entry.score;
+        }
+
+        entry.key = key;
+        entry.score = evaluatePawns(board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).getBits(),
+                                    board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).getBits());
+
+        return entry.score;
+    }
+
+    void PawnHashTable::clear()
+    {
+        std::fill(table, table + mask + 1, PawnEntry{});
+        probes = 0;
+        hits = 0;
+    }
+
+    double PawnHashTable::hitRate() const
+    {
+        return probes == 0 ? 0.0 : static_cast<double>(hits) / probes;
+    }
+
+    PawnHashTable& PawnHashTable::local()
+    {
+        static thread_local PawnHashTable table;
+        return table;
+    }
+
+} // xoxo
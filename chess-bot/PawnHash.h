@@ -0,0 +1,62 @@
+#ifndef CHESS_PAWNHASH_H
+#define CHESS_PAWNHASH_H
+
+#include <cstdint>
+#include "chess.hpp"
+
+namespace xoxo {
+
+    const int DEFAULT_PAWN_HASH_ENTRIES = 1 << 14;
+
+    //pawn structure terms, in centipawns
+    const int DOUBLED_PAWN_PENALTY = 15;
+    const int ISOLATED_PAWN_PENALTY = 15;
+    const int BACKWARD_PAWN_PENALTY = 10;
+    const int PASSED_PAWN_BONUS[8] = {0, 5, 10, 20, 35, 60, 100, 0};
+    const int SHIELD_NEAR_BONUS = 10;
+    const int SHIELD_FAR_BONUS = 5;
+
+    struct PawnEntry {
+        uint64_t key = 0;
+        int score = 0;
+    };
+
+    //hash of the pawns only, so every position with the same pawns shares an entry
+    uint64_t pawnKey(const chess::Board& board);
+
+    //doubled, isolated, backward and passed pawns from white's point of view
+    int evaluatePawns(uint64_t whitePawns, uint64_t blackPawns);
+
+    //own pawns in front of the king, from white's point of view. depends on the kings so it is never cached
+    int evaluatePawnShield(const chess::Board& board);
+
+    class PawnHashTable {
+    public:
+        //the table comes out of the memory the engine memory budget holds back, and is a single entry when even
+        //that is spent
+        explicit PawnHashTable(int entries = DEFAULT_PAWN_HASH_ENTRIES);
+        ~PawnHashTable();
+        PawnHashTable(const PawnHashTable&) = delete;
+        PawnHashTable& operator=(const PawnHashTable&) = delete;
+
+        uint64_t probes = 0;
+        uint64_t hits = 0;
+
+        //pawn structure score for the board, from white's point of view
+        int probe(const chess::Board& board);
+        void clear();
+        double hitRate() const;
+
+        //one table per thread, pawn entries are too cheap to share behind atomics
+        static PawnHashTable& local();
+
+    private:
+        PawnEntry* table = nullptr;
+        uint64_t mask;
+        //the table when the budget has no room for one
+        PawnEntry fallback;
+    };
+
+} // xoxo
+
+#endif //CHESS_PAWNHASH_H
@@ -0,0 +1,204 @@
+#include "PerfCounters.h"
+#include <cstdio>
+#include <utility>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define XOXO_HAS_PERF_EVENTS 1
+#endif
+
+namespace xoxo {
+
+    //indexed by PerfCounter and PerfPhase, these are the keys of the json output
+    const char* COUNTER_NAMES[] = {"cycles", "instructions", "cache_misses", "branch_misses", "dtlb_misses"};
+    const char* PHASE_NAMES[] = {"select", "expand", "simulate", "backprop", "movegen", "eval"};
+
+    void PerfTotals::add(const PerfTotals& other)
+    {
+        for(int phase = 0; phase < PERF_PHASE_COUNT; phase++)
+        {
+            calls[phase] += other.calls[phase];
+
+            for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+                counters[phase][counter] += other.counters[phase][counter];
+        }
+
+        for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+            available[counter] = available[counter] || other.available[counter];
+    }
+
+    bool PerfTotals::empty() const
+    {
+        for(uint64_t count : calls)
+        {
+            if(count != 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    std::string PerfTotals::json() const
+    {
+        std::string out = "{";
+        char field[64];
+
+        for(int phase = 0; phase < PERF_PHASE_COUNT; phase++)
+        {
+            std::snprintf(field, sizeof(field), "%s\"%s\": {\"calls\": %llu", phase > 0 ? ", " : "",
+                          PHASE_NAMES[phase], (unsigned long long)calls[phase]);
+            out += field;
+
+            for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+            {
+                if(!available[counter])
+                    continue;
+
+                std::snprintf(field, sizeof(field), ", \"%s\": %llu", COUNTER_NAMES[counter],
+                              (unsigned long long)counters[phase][counter]);
+                out += field;
+            }
+
+            out += "}";
+        }
+
+        return out + "}";
+    }
+
+#ifdef XOXO_HAS_PERF_EVENTS
+    //type and config of every PerfCounter
+    const std::pair<uint32_t, uint64_t> COUNTER_EVENTS[] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+                             PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    };
+
+    int openCounter(uint32_t type, uint64_t config, int group)
+    {
+        perf_event_attr attributes{};
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        //the group starts disabled and is enabled as a whole once every member is open
+        attributes.disabled = group < 0 ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP;
+
+        //this thread, any cpu
+        return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, group, 0));
+    }
+#endif
+
+    PerfCounters::PerfCounters()
+    {
+        descriptors.fill(-1);
+        slots.fill(-1);
+
+#ifdef XOXO_HAS_PERF_EVENTS
+        //cycles lead the group, without them nothing else is worth opening
+        for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+        {
+            if(counter > 0 && descriptors[0] < 0)
+                break;
+
+            descriptors[counter] = openCounter(COUNTER_EVENTS[counter].first, COUNTER_EVENTS[counter].second,
+                                               descriptors[0]);
+            if(descriptors[counter] >= 0)
+                slots[counter] = opened++;
+        }
+
+        if(descriptors[0] >= 0)
+        {
+            ioctl(descriptors[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(descriptors[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+    PerfCounters::~PerfCounters()
+    {
+#ifdef XOXO_HAS_PERF_EVENTS
+        for(int descriptor : descriptors)
+        {
+            if(descriptor >= 0)
+                close(descriptor);
+        }
+#endif
+    }
+
+    void PerfCounters::read(PerfReading& reading) const
+    {
+        reading.fill(0);
+
+#ifdef XOXO_HAS_PERF_EVENTS
+        if(!available())
+            return;
+
+        //a group read is the number of counters followed by their values in the order they were opened
+        uint64_t buffer[1 + PERF_COUNTER_COUNT];
+        if(::read(descriptors[0], buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t) * (1 + opened)))
+            return;
+
+        for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+        {
+            if(slots[counter] >= 0)
+                reading[counter] = buffer[1 + slots[counter]];
+        }
+#endif
+    }
+
+    PerfCounters& PerfCounters::local()
+    {
+        static thread_local PerfCounters counters;
+        return counters;
+    }
+
+    void enablePerfCounters(bool enabled)
+    {
+        perfCountersActive = enabled;
+    }
+
+    PerfTotals& localTotals()
+    {
+        static thread_local PerfTotals totals;
+        return totals;
+    }
+
+    PerfTotals takePerfTotals()
+    {
+        PerfTotals taken = localTotals();
+        localTotals() = PerfTotals();
+
+        const PerfCounters& counters = PerfCounters::local();
+        for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+            taken.available[counter] = counters.available(static_cast<PerfCounter>(counter));
+
+        return taken;
+    }
+
+    void PerfScope::begin()
+    {
+        PerfCounters::local().read(start);
+    }
+
+    void PerfScope::end()
+    {
+        PerfReading stop;
+        PerfCounters::local().read(stop);
+
+        PerfTotals& totals = localTotals();
+        int index = static_cast<int>(phase);
+        totals.calls[index]++;
+
+        for(int counter = 0; counter < PERF_COUNTER_COUNT; counter++)
+            totals.counters[index][counter] += stop[counter] - start[counter];
+    }
+
+} // xoxo
@@ -0,0 +1,110 @@
+#ifndef CHESS_PERFCOUNTERS_H
+#define CHESS_PERFCOUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace xoxo {
+
+    enum class PerfCounter : uint8_t {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES,
+        DTLB_MISSES,
+        COUNT
+    };
+
+    //the MCTS iteration phases, and the alpha-beta work they and MinMax spend most of their time in. phases nest:
+    //the move generation and evaluation of a playout are counted in SIMULATE as well
+    enum class PerfPhase : uint8_t {
+        SELECT,
+        EXPAND,
+        SIMULATE,
+        BACKPROP,
+        MOVEGEN,
+        EVAL,
+        COUNT
+    };
+
+    const int PERF_COUNTER_COUNT = static_cast<int>(PerfCounter::COUNT);
+    const int PERF_PHASE_COUNT = static_cast<int>(PerfPhase::COUNT);
+
+    using PerfReading = std::array<uint64_t, PERF_COUNTER_COUNT>;
+
+    //counter totals per phase, summed by whoever collects them from the search threads
+    struct PerfTotals {
+        std::array<PerfReading, PERF_PHASE_COUNT> counters{};
+        std::array<uint64_t, PERF_PHASE_COUNT> calls{};
+        //which counters the system actually gave us, the others stay 0
+        std::array<bool, PERF_COUNTER_COUNT> available{};
+
+        void add(const PerfTotals& other);
+        bool empty() const;
+        //one object per phase with its calls and counters, counters the system did not give us are left out
+        std::string json() const;
+    };
+
+    //the calling thread's hardware counters, opened through perf_event_open the first time the thread needs them.
+    //on other systems, in containers without perf access or with perf_event_paranoid too high, nothing opens and
+    //every reading is zero
+    class PerfCounters {
+    public:
+        PerfCounters();
+        ~PerfCounters();
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        bool available() const { return descriptors[0] >= 0; }
+        bool available(PerfCounter counter) const { return descriptors[static_cast<int>(counter)] >= 0; }
+        void read(PerfReading& reading) const;
+
+        static PerfCounters& local();
+
+    private:
+        std::array<int, PERF_COUNTER_COUNT> descriptors;
+        //position of each open counter in the group read
+        std::array<int, PERF_COUNTER_COUNT> slots;
+        int opened = 0;
+    };
+
+    //counting is off until enablePerfCounters, so a search that is not being profiled pays one relaxed load per
+    //phase. a counter read is a system call, profiled searches run noticeably slower
+    void enablePerfCounters(bool enabled);
+    inline std::atomic<bool> perfCountersActive{false};
+
+    //what the calling thread counted since the last call, and starts over
+    PerfTotals takePerfTotals();
+
+    //adds the counters between construction and destruction to the calling thread's totals for phase
+    class PerfScope {
+    public:
+        explicit PerfScope(PerfPhase phase) : phase(phase), active(perfCountersActive.load(std::memory_order_relaxed))
+        {
+            if(active)
+                begin();
+        }
+
+        ~PerfScope()
+        {
+            if(active)
+                end();
+        }
+
+        PerfScope(const PerfScope&) = delete;
+        PerfScope& operator=(const PerfScope&) = delete;
+
+    private:
+        void begin();
+        void end();
+
+        PerfPhase phase;
+        bool active;
+        PerfReading start;
+    };
+
+} // xoxo
+
+#endif //CHESS_PERFCOUNTERS_H
@@ -0,0 +1,136 @@
+#include "SEE.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace xoxo {
+
+    //every piece of either color attacking square through occupied
+    uint64_t attackersTo(const uint64_t pieces[6], const uint64_t colors[2], int square, uint64_t occupied)
+    {
+        chess::Square sq(square);
+        chess::Bitboard occ(occupied);
+        uint64_t diagonal = pieces[2] | pieces[4];
+        uint64_t straight = pieces[3] | pieces[4];
+
+        return (chess::attacks::pawn(chess::Color::BLACK, sq).getBits() & pieces[0] & colors[0]) |
+               (chess::attacks::pawn(chess::Color::WHITE, sq).getBits() & pieces[0] & colors[1]) |
+               (chess::attacks::knight(sq).getBits() & pieces[1]) |
+               (chess::attacks::king(sq).getBits() & pieces[5]) |
+               (chess::attacks::bishop(sq, occ).getBits() & diagonal) |
+               (chess::attacks::rook(sq, occ).getBits() & straight);
+    }
+
+    int see(const chess::Board& board, chess::Move move)
+    {
+        if(move.typeOf() == chess::Move::CASTLING)
+            return 0;
+
+        uint64_t pieces[6];
+        for(int pt = 0; pt < 6; pt++)
+            pieces[pt] = board.pieces(static_cast<chess::PieceType::underlying>(pt)).getBits();
+
+        uint64_t colors[2] = {board.us(chess::Color::WHITE).getBits(), board.us(chess::Color::BLACK).getBits()};
+
+        int from = move.from().index();
+        int to = move.to().index();
+        int side = static_cast<int>(board.sideToMove());
+
+        uint64_t occupied = board.occ().getBits();
+        int attacker = static_cast<int>(board.at(move.from()).type());
+
+        //gain[d] is what the side making capture d has won so far if the exchange stops there. the exchange is
+        //played out to the end rather than cut off once its sign is known, priors use the exact value
+        int gain[32];
+        int d = 0;
+
+        if(move.typeOf() == chess::Move::ENPASSANT)
+        {
+            gain[0] = SEE_VALUES[0];
+            //the captured pawn sits behind the target square
+            occupied ^= 1ULL << (to ^ 8);
+        }
+        else
+        {
+            gain[0] = SEE_VALUES[static_cast<int>(board.at(move.to()).type())];
+        }
+
+        if(move.typeOf() == chess::Move::PROMOTION)
+        {
+            attacker = static_cast<int>(move.promotionType());
+            gain[0] += SEE_VALUES[attacker] - SEE_VALUES[0];
+        }
+
+        uint64_t diagonal = pieces[2] | pieces[4];
+        uint64_t straight = pieces[3] | pieces[4];
+        uint64_t fromSet = 1ULL << from;
+        uint64_t attackers = attackersTo(pieces, colors, to, occupied);
+
+        //the line the move itself comes in on, a pawn push opens a file and a king step any line
+        int fileDelta = (to & 7) - (from & 7);
+        int rankDelta = (to >> 3) - (from >> 3);
+        bool moveDiagonal = fileDelta == rankDelta || fileDelta == -rankDelta;
+        bool moveStraight = fileDelta == 0 || rankDelta == 0;
+
+        do
+        {
+            d++;
+            //speculative: what capture d wins if the piece that just landed on the square is taken back
+            gain[d] = SEE_VALUES[attacker] - gain[d - 1];
+
+            occupied ^= fromSet;
+            attackers &= ~fromSet;
+
+            //x-rays: a slider behind the piece that just moved now sees the square
+            if(d == 1 ? moveDiagonal : (attacker == 0 || attacker == 2 || attacker == 4))
+                attackers |= chess::attacks::bishop(chess::Square(to), chess::Bitboard(occupied)).getBits() &
+                             diagonal & occupied;
+            if(d == 1 ? moveStraight : (attacker == 3 || attacker == 4))
+                attackers |= chess::attacks::rook(chess::Square(to), chess::Bitboard(occupied)).getBits() &
+                             straight & occupied;
+
+            side ^= 1;
+
+            //least valuable attacker of the side to capture next
+            fromSet = 0;
+            uint64_t ours = attackers & colors[side];
+
+            for(int pt = 0; pt < 6 && ours != 0; pt++)
+            {
+                uint64_t candidates = ours & pieces[pt];
+                if(candidates == 0)
+                    continue;
+
+                //the king can only take last, when nothing defends the square anymore
+                if(pt == 5 && (attackers & colors[side ^ 1]) != 0)
+                    break;
+
+                fromSet = candidates & (0 - candidates);
+                attacker = pt;
+                break;
+            }
+        } while(fromSet != 0 && d < 31);
+
+        while(--d)
+            gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+
+        return gain[0];
+    }
+
+    bool seeAtLeast(const chess::Board& board, chess::Move move, int threshold)
+    {
+        //the opponent can always stop after the first capture, so a move never wins more than its victim. and if
+        //losing the moving piece for the victim still makes the threshold, no exchange can fall short of it
+        if(move.typeOf() == chess::Move::NORMAL || move.typeOf() == chess::Move::ENPASSANT)
+        {
+            bool enPassant = move.typeOf() == chess::Move::ENPASSANT;
+            int victim = SEE_VALUES[enPassant ? 0 : static_cast<int>(board.at(move.to()).type())];
+            if(victim < threshold)
+                return false;
+            if(victim - SEE_VALUES[static_cast<int>(board.at(move.from()).type())] >= threshold)
+                return true;
+        }
+
+        return see(board, move) >= threshold;
+    }
+
+} // xoxo
@@ -0,0 +1,23 @@
+#ifndef CHESS_SEE_H
+#define CHESS_SEE_H
+
+#include "chess.hpp"
+
+namespace xoxo {
+
+    //piece values the exchanges are counted in, indexed by piece type, same scale as the material scores
+    inline constexpr int SEE_VALUES[7] = {100, 320, 330, 500, 900, 20000, 0};
+
+    //static exchange evaluation: material the side to move wins (negative: loses) on move.to() if both sides keep
+    //recapturing there with their least valuable attacker, each side free to stop when going on would lose.
+    //sliders hidden behind the moving piece or a capturer join in once it has moved. pins and checks are ignored.
+    //quiet moves score the loss of the moving piece if it can be taken for free, castling always scores 0
+    int see(const chess::Board& board, chess::Move move);
+
+    //true if see(board, move) >= threshold. most captures are decided by the victim and the moving piece alone, the
+    //exchange is only played out when they cannot tell
+    bool seeAtLeast(const chess::Board& board, chess::Move move, int threshold);
+
+} // xoxo
+
+#endif //CHESS_SEE_H
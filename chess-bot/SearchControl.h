@@ -0,0 +1,101 @@
+#ifndef CHESS_SEARCHCONTROL_H
+#define CHESS_SEARCHCONTROL_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace xoxo {
+
+    const int SNAPSHOT_ROOT_MOVES = 32;
+
+    struct RootMoveInfo {
+        char uci[8] = {};
+        int visits = 0;
+        //win probability for the player to move at the root
+        float value = 0;
+        float prior = 0;
+    };
+
+    //what a running search looks like from the outside, copied out a few times per second
+    struct SearchSnapshot {
+        uint64_t iterations = 0;
+        double seconds = 0;
+        double nps = 0;
+        //deepest selection path so far
+        int depth = 0;
+        char bestMove[8] = {};
+        //most visited root moves first
+        int rootMoveCount = 0;
+        RootMoveInfo rootMoves[SNAPSHOT_ROOT_MOVES];
+        bool finished = false;
+    };
+
+    //single writer, any number of readers, nobody ever waits on a lock. the writer bumps the sequence to odd, writes,
+    //and bumps it back to even; a reader retries whenever the sequence moved under it. the payload lives in atomic
+    //words so a racing read is merely stale, never undefined
+    template <typename T>
+    class SnapshotChannel {
+        static_assert(std::is_trivially_copyable_v<T>, "snapshots are copied word by word");
+
+    public:
+        void publish(const T& value)
+        {
+            uint64_t words[WORDS] = {};
+            std::memcpy(words, &value, sizeof(T));
+
+            uint64_t seq = sequence.load(std::memory_order_relaxed);
+            sequence.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            for(size_t i = 0; i < WORDS; i++)
+                data[i].store(words[i], std::memory_order_relaxed);
+
+            sequence.store(seq + 2, std::memory_order_release);
+        }
+
+        //false until the first publish
+        bool read(T& value) const
+        {
+            uint64_t words[WORDS];
+
+            for(;;)
+            {
+                uint64_t before = sequence.load(std::memory_order_acquire);
+
+                if(before == 0)
+                    return false;
+
+                if(before & 1)
+                    continue;
+
+                for(size_t i = 0; i < WORDS; i++)
+                    words[i] = data[i].load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if(sequence.load(std::memory_order_relaxed) == before)
+                    break;
+            }
+
+            std::memcpy(&value, words, sizeof(T));
+            return true;
+        }
+
+    private:
+        static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+        std::atomic<uint64_t> sequence{0};
+        std::atomic<uint64_t> data[WORDS] = {};
+    };
+
+    //handed to a search running on another thread: the owner raises stop, the search publishes snapshots
+    struct SearchControl {
+        std::atomic<bool> stop{false};
+        SnapshotChannel<SearchSnapshot> snapshots;
+    };
+
+} // xoxo
+
+#endif //CHESS_SEARCHCONTROL_H
@@ -0,0 +1,156 @@
+#include "SearchTrace.h"
+
+//the recorder and its writer thread only exist in trace builds, the reader needs no more than the header's types
+#ifdef XOXO_TRACE
+
+#include <algorithm>
+
+namespace xoxo {
+
+    //how often the writer thread empties the rings
+    const std::chrono::milliseconds TRACE_FLUSH_INTERVAL{10};
+
+    size_t TraceRing::drain(FILE* file)
+    {
+        uint64_t tail = this->tail.load(std::memory_order_relaxed);
+        uint64_t head = this->head.load(std::memory_order_acquire);
+        if(head == tail)
+            return 0;
+
+        TraceBlockHeader header;
+        header.thread = thread;
+        header.count = static_cast<uint32_t>(head - tail);
+        std::fwrite(&header, sizeof(header), 1, file);
+
+        //the pending records wrap around the end of the buffer at most once
+        size_t first = tail & (TRACE_RING_SIZE - 1);
+        size_t firstCount = std::min<size_t>(header.count, TRACE_RING_SIZE - first);
+        std::fwrite(records.data() + first, sizeof(TraceRecord), firstCount, file);
+        std::fwrite(records.data(), sizeof(TraceRecord), header.count - firstCount, file);
+
+        this->tail.store(head, std::memory_order_release);
+        return header.count;
+    }
+
+    bool TraceRecorder::start(const std::string& path)
+    {
+        stop();
+
+        std::lock_guard lock(mutex);
+        file = std::fopen(path.c_str(), "wb");
+        if(file == nullptr)
+            return false;
+
+        std::fwrite(TRACE_MAGIC, sizeof(TRACE_MAGIC), 1, file);
+        rings.clear();
+        recordsWritten = 0;
+        session++;
+        begin = std::chrono::steady_clock::now();
+        stopping = false;
+
+        writer = std::thread([this]
+        {
+            while(!stopping.load(std::memory_order_relaxed))
+            {
+                std::this_thread::sleep_for(TRACE_FLUSH_INTERVAL);
+                drainAll();
+            }
+        });
+
+        active = true;
+        return true;
+    }
+
+    void TraceRecorder::stop()
+    {
+        if(!writer.joinable())
+            return;
+
+        active = false;
+        stopping = true;
+        writer.join();
+
+        //whatever the searches pushed since the writer's last pass
+        drainAll();
+
+        std::lock_guard lock(mutex);
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    void TraceRecorder::record(TraceEvent event, uint64_t key, uint16_t move, int depth, int value, uint32_t count)
+    {
+        TraceRing& ring = localRing();
+
+        //the events the reader measures search and iteration times with are always stamped exactly
+        bool milestone = event == TraceEvent::SEARCH_BEGIN || event == TraceEvent::SEARCH_END ||
+                         event == TraceEvent::ITERATION;
+        if(milestone || ++ring.sinceClock >= TRACE_CLOCK_INTERVAL)
+        {
+            ring.lastTime = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - begin).count());
+            ring.sinceClock = 0;
+        }
+
+        TraceRecord record;
+        record.key = key;
+        record.time = ring.lastTime;
+        record.value = value;
+        record.count = count;
+        record.move = move;
+        record.event = event;
+        record.depth = static_cast<uint8_t>(std::clamp(depth, 0, 255));
+
+        ring.push(record);
+    }
+
+    uint64_t TraceRecorder::dropped() const
+    {
+        std::lock_guard lock(mutex);
+
+        uint64_t total = 0;
+        for(const auto& ring : rings)
+            total += ring->dropped.load(std::memory_order_relaxed);
+
+        return total;
+    }
+
+    TraceRecorder& TraceRecorder::global()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    TraceRing& TraceRecorder::localRing()
+    {
+        //the recorder keeps its own reference, so a ring outlives a thread that exits before it was drained
+        static thread_local std::shared_ptr<TraceRing> ring;
+        static thread_local uint32_t ringSession = 0;
+
+        uint32_t current = session.load(std::memory_order_relaxed);
+        if(ring == nullptr || ringSession != current)
+        {
+            std::lock_guard lock(mutex);
+            ring = std::make_shared<TraceRing>(static_cast<uint32_t>(rings.size()));
+            ringSession = current;
+            rings.push_back(ring);
+        }
+
+        return *ring;
+    }
+
+    void TraceRecorder::drainAll()
+    {
+        std::lock_guard lock(mutex);
+        if(file == nullptr)
+            return;
+
+        for(const auto& ring : rings)
+            recordsWritten.fetch_add(ring->drain(file), std::memory_order_relaxed);
+
+        std::fflush(file);
+    }
+
+} // xoxo
+
+#endif //XOXO_TRACE
@@ -0,0 +1,148 @@
+#ifndef CHESS_SEARCHTRACE_H
+#define CHESS_SEARCHTRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xoxo {
+
+    enum class TraceEvent : uint8_t {
+        //key is the root, count the iterations or depth limit asked for
+        SEARCH_BEGIN,
+        //count is the iterations actually run, for alpha-beta the nodes, with the best move and its score
+        SEARCH_END,
+        //key is the leaf, move the root move the path went through, depth the path length, count the leaf visits
+        SELECT,
+        //key is the expanded node, count its children
+        EXPAND,
+        //key is the leaf, value the result backed up in thousandths of a win
+        PLAYOUT,
+        //alpha-beta fail high: key is the node, move the refutation, value the score, count the index of the move
+        CUTOFF,
+        //alpha-beta iteration finished: move is the best move, value its score
+        ITERATION,
+        COUNT
+    };
+
+    //one traced event in 24 bytes, written as raw records
+    struct TraceRecord {
+        uint64_t key = 0;
+        //microseconds since the recorder was started. SEARCH_BEGIN, SEARCH_END and ITERATION read the clock, the
+        //other events share the reading of the thread's last TRACE_CLOCK_INTERVAL records
+        uint32_t time = 0;
+        int32_t value = 0;
+        uint32_t count = 0;
+        //chess::Move::move()
+        uint16_t move = 0;
+        TraceEvent event = TraceEvent::COUNT;
+        uint8_t depth = 0;
+    };
+
+    static_assert(sizeof(TraceRecord) == 24, "records are read and written as raw 24 byte blocks");
+
+    //a trace file is TRACE_MAGIC followed by blocks, each a TraceBlockHeader and its records
+    const char TRACE_MAGIC[8] = {'X', 'O', 'T', 'R', 'A', 'C', 'E', '1'};
+
+    struct TraceBlockHeader {
+        uint32_t thread = 0;
+        uint32_t count = 0;
+    };
+
+    //records per thread buffer, a full buffer drops records rather than stall the search
+    const size_t TRACE_RING_SIZE = 1 << 16;
+    //reading the clock costs more than the rest of a record, so frequent events only read it this often
+    const uint32_t TRACE_CLOCK_INTERVAL = 64;
+
+    //single producer, single consumer: the search thread pushes, the recorder's writer thread drains
+    class TraceRing {
+    public:
+        explicit TraceRing(uint32_t thread) : thread(thread), records(TRACE_RING_SIZE) {}
+
+        void push(const TraceRecord& record)
+        {
+            uint64_t head = this->head.load(std::memory_order_relaxed);
+            if(head - tail.load(std::memory_order_acquire) >= TRACE_RING_SIZE)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            records[head & (TRACE_RING_SIZE - 1)] = record;
+            this->head.store(head + 1, std::memory_order_release);
+        }
+
+        //writes what was pushed so far to file, returns the records written
+        size_t drain(FILE* file);
+
+        const uint32_t thread;
+        std::atomic<uint64_t> dropped{0};
+        //the producer's last clock reading and the records stamped with it since, nobody else touches them
+        uint32_t lastTime = 0;
+        uint32_t sinceClock = 0;
+
+    private:
+        std::vector<TraceRecord> records;
+        std::atomic<uint64_t> head{0};
+        std::atomic<uint64_t> tail{0};
+    };
+
+    //collects the rings of every thread that traced something and writes them to one file from a background
+    //thread, so tracing costs the search a store into its own buffer and nothing else. only defined in builds with
+    //XOXO_TRACE, without it nothing starts the writer thread
+    class TraceRecorder {
+    public:
+        ~TraceRecorder() { stop(); }
+
+        bool start(const std::string& path);
+        //drains what is left and closes the file
+        void stop();
+        bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+        void record(TraceEvent event, uint64_t key, uint16_t move, int depth, int value, uint32_t count);
+
+        uint64_t written() const { return recordsWritten.load(std::memory_order_relaxed); }
+        uint64_t dropped() const;
+
+        static TraceRecorder& global();
+
+    private:
+        TraceRing& localRing();
+        void drainAll();
+
+        std::atomic<bool> active{false};
+        std::atomic<uint64_t> recordsWritten{0};
+        //bumped on every start so rings of an earlier trace are not reused
+        std::atomic<uint32_t> session{0};
+        std::chrono::steady_clock::time_point begin;
+
+        mutable std::mutex mutex;
+        FILE* file = nullptr;
+        std::vector<std::shared_ptr<TraceRing>> rings;
+        std::thread writer;
+        std::atomic<bool> stopping{false};
+    };
+
+} // xoxo
+
+//tracing is compiled in with XOXO_TRACE (cmake -DCHESS_TRACE=ON) and then only records while a recorder is started.
+//without it the macro is empty and the arguments are never evaluated
+#ifdef XOXO_TRACE
+#define XOXO_TRACE_EVENT(event, key, move, depth, value, count)                                                       \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        xoxo::TraceRecorder& recorder_ = xoxo::TraceRecorder::global();                                                \
+        if(recorder_.enabled())                                                                                        \
+            recorder_.record(event, key, move, depth, value, count);                                                   \
+    } while(false)
+#else
+#define XOXO_TRACE_EVENT(event, key, move, depth, value, count) ((void)0)
+#endif
+
+#endif //CHESS_SEARCHTRACE_H
@@ -0,0 +1,45 @@
+#include "Terminal.h"
+#include <algorithm>
+
+namespace xoxo {
+
+    bool RepetitionStack::isRepetition(uint64_t key, int halfMoveClock) const
+    {
+        int size = static_cast<int>(keys.size());
+        int oldest = std::max(0, size - halfMoveClock);
+
+        for(int i = size - 2; i >= oldest; i -= 2)
+        {
+            if(keys[i] == key)
+                return true;
+        }
+
+        return false;
+    }
+
+    Terminal getTerminal(const chess::Board& board, const chess::Movelist& moves, const RepetitionStack* repetitions)
+    {
+        if(moves.empty())
+            return board.inCheck() ? Terminal::CHECKMATE : Terminal::STALEMATE;
+
+        if(board.halfMoveClock() >= 100 || board.isInsufficientMaterial())
+            return Terminal::DRAW;
+
+        if(repetitions != nullptr && repetitions->isRepetition(board.hash(), static_cast<int>(board.halfMoveClock())))
+            return Terminal::REPETITION;
+
+        return Terminal::NONE;
+    }
+
+    bool isCheckmate(const chess::Board& board)
+    {
+        if(!board.inCheck())
+            return false;
+
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, board);
+
+        return moves.empty();
+    }
+
+} // xoxo
@@ -0,0 +1,48 @@
+#ifndef CHESS_TERMINAL_H
+#define CHESS_TERMINAL_H
+
+#include <cstdint>
+#include <vector>
+#include "chess.hpp"
+
+namespace xoxo {
+
+    enum class Terminal : int8_t {
+        NONE,
+        CHECKMATE,
+        STALEMATE,
+        REPETITION,
+        //fifty move rule or insufficient material
+        DRAW
+    };
+
+    //zobrist keys of the positions that led to the current one, oldest first.
+    //the searches push before making a move and pop after unmaking it, so the stack always mirrors the line
+    //being searched on top of whatever game history the caller handed in
+    class RepetitionStack {
+    public:
+        void push(uint64_t key) { keys.push_back(key); }
+        void pop() { keys.pop_back(); }
+        void resize(size_t size) { keys.resize(size); }
+        void set(size_t index, uint64_t key) { keys[index] = key; }
+        void clear() { keys.clear(); }
+        size_t size() const { return keys.size(); }
+
+        //only positions since the last capture or pawn move can repeat, and only every other one has the same side
+        //to move, so at most halfMoveClock / 2 keys are compared
+        bool isRepetition(uint64_t key, int halfMoveClock) const;
+
+    private:
+        std::vector<uint64_t> keys;
+    };
+
+    //classifies the board from the legal moves the caller already generated for it, so no second move generation
+    //is needed. repetitions are only detected when a stack is given
+    Terminal getTerminal(const chess::Board& board, const chess::Movelist& moves, const RepetitionStack* repetitions);
+
+    //only generates moves for boards in check, which is all a checkmate test needs
+    bool isCheckmate(const chess::Board& board);
+
+} // xoxo
+
+#endif //CHESS_TERMINAL_H
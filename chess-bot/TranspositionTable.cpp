@@ -0,0 +1,113 @@
+#include "TranspositionTable.h"
+#include "EngineMemory.h"
+#include <algorithm>
+#include <bit>
+#include <memory>
+
+namespace xoxo {
+
+    //data word layout: move in bits 0-15, depth in 16-23, bound in 24-31, score in 32-63
+    uint64_t packEntry(const TTData& data)
+    {
+        return static_cast<uint64_t>(data.move.move()) |
+               static_cast<uint64_t>(static_cast<uint8_t>(data.depth)) << 16 |
+               static_cast<uint64_t>(data.bound) << 24 |
+               static_cast<uint64_t>(static_cast<uint32_t>(data.score)) << 32;
+    }
+
+    TTData unpackEntry(uint64_t word)
+    {
+        TTData data;
+        data.move = chess::Move(static_cast<uint16_t>(word));
+        data.depth = static_cast<int8_t>(word >> 16);
+        data.bound = static_cast<Bound>(static_cast<uint8_t>(word >> 24));
+        data.score = static_cast<int32_t>(static_cast<uint32_t>(word >> 32));
+        return data;
+    }
+
+    TranspositionTable::TranspositionTable(uint64_t entries)
+    {
+        resize(entries);
+    }
+
+    TranspositionTable::~TranspositionTable()
+    {
+        if(table != &fallback)
+            EngineMemory::global().release(table, size() * sizeof(Entry), MemoryTag::TRANSPOSITION_TABLE);
+    }
+
+    bool TranspositionTable::probe(uint64_t key, TTData& data) const
+    {
+        const Entry& entry = table[key & mask];
+        uint64_t word = entry.data.load(std::memory_order_relaxed);
+
+        if((entry.key.load(std::memory_order_relaxed) ^ word) != key || word == 0)
+            return false;
+
+        data = unpackEntry(word);
+        return true;
+    }
+
+    void TranspositionTable::store(uint64_t key, const TTData& data)
+    {
+        Entry& entry = table[key & mask];
+        uint64_t oldWord = entry.data.load(std::memory_order_relaxed);
+        bool samePosition = (entry.key.load(std::memory_order_relaxed) ^ oldWord) == key;
+
+        if(samePosition && unpackEntry(oldWord).depth > data.depth && data.bound != Bound::EXACT)
+            return;
+
+        uint64_t word = packEntry(data);
+        entry.key.store(key ^ word, std::memory_order_relaxed);
+        entry.data.store(word, std::memory_order_relaxed);
+    }
+
+    void TranspositionTable::resize(uint64_t entries)
+    {
+        EngineMemory& memory = EngineMemory::global();
+        if(table != nullptr && table != &fallback)
+            memory.release(table, size() * sizeof(Entry), MemoryTag::TRANSPOSITION_TABLE);
+        table = nullptr;
+
+        uint64_t wanted = std::bit_floor(entries > 0 ? entries : 1) * sizeof(Entry);
+        uint64_t bytes = wanted;
+        void* block = memory.allocateUpTo(bytes, sizeof(Entry), MemoryTag::TRANSPOSITION_TABLE);
+
+        //nothing left of the budget, a chunk of what is held back keeps the searches running
+        if(block == nullptr)
+        {
+            bytes = std::min(wanted, MEMORY_CHUNK);
+            block = memory.allocateReserved(bytes, MemoryTag::TRANSPOSITION_TABLE);
+        }
+
+        //not even that, a single slot makes every store replace the last one but probes and stores still work
+        if(block == nullptr)
+        {
+            table = &fallback;
+            mask = 0;
+            clear();
+            return;
+        }
+
+        uint64_t size = bytes / sizeof(Entry);
+        table = static_cast<Entry*>(block);
+        std::uninitialized_value_construct_n(table, size);
+        mask = size - 1;
+    }
+
+    void TranspositionTable::clear()
+    {
+        for(uint64_t i = 0; i <= mask; i++)
+        {
+            table[i].key.store(0, std::memory_order_relaxed);
+            table[i].data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    TranspositionTable& TranspositionTable::shared()
+    {
+        static TranspositionTable table;
+        return table;
+    }
+
+} // xoxo
@@ -0,0 +1,64 @@
+#ifndef CHESS_TRANSPOSITIONTABLE_H
+#define CHESS_TRANSPOSITIONTABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include "chess.hpp"
+
+namespace xoxo {
+
+    const uint64_t DEFAULT_TT_ENTRIES = 1 << 20;
+
+    enum class Bound : uint8_t {
+        NONE,
+        EXACT,
+        //the score is at least this (failed high)
+        LOWER,
+        //the score is at most this (failed low)
+        UPPER
+    };
+
+    struct TTData {
+        int score = 0;
+        int depth = 0;
+        Bound bound = Bound::NONE;
+        chess::Move move = chess::Move::NO_MOVE;
+    };
+
+    //alpha-beta results shared by every search in the process, MinMax and the MCTS leaf searches alike.
+    //entries are two atomic words with the key stored xor the data, so a torn write just reads as a miss
+    class TranspositionTable {
+    public:
+        explicit TranspositionTable(uint64_t entries = DEFAULT_TT_ENTRIES);
+        ~TranspositionTable();
+        TranspositionTable(const TranspositionTable&) = delete;
+        TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+        bool probe(uint64_t key, TTData& data) const;
+        //keeps a deeper result for the same position, anything else is replaced
+        void store(uint64_t key, const TTData& data);
+
+        //not safe while a search is running. the table comes out of the engine memory budget and shrinks to what
+        //is left of it, with nothing left it takes a chunk of the memory held back, and with not even that it is a
+        //single entry
+        void resize(uint64_t entries);
+        void clear();
+        uint64_t size() const { return mask + 1; }
+
+        static TranspositionTable& shared();
+
+    private:
+        struct Entry {
+            std::atomic<uint64_t> key{0};
+            std::atomic<uint64_t> data{0};
+        };
+
+        Entry* table = nullptr;
+        uint64_t mask = 0;
+        //the table when the budget has no room for one
+        Entry fallback;
+    };
+
+} // xoxo
+
+#endif //CHESS_TRANSPOSITIONTABLE_H
@@ -5,11 +5,46 @@
 #include "chess.hpp"
 #include <random>
 #include "MCTS.h"
+#include "MateSolver.h"
+#include "MinMax.h"
+#include "SearchTrace.h"
+#include <cstdlib>
+#include <new>
 using namespace ChessSimulator;
 
+// MCTS iterations of one move
+const int MOVE_ITERATIONS = 1000;
+// a solver node is one move generation and a make/unmake per move, dozens of times cheaper than an MCTS iteration, so
+// this keeps the solver to a few percent of the move. the clock is only a backstop
+const uint64_t MATE_SOLVER_NODES = 4 * MOVE_ITERATIONS;
+const std::chrono::milliseconds MATE_SOLVER_BUDGET{20};
+// the solver only runs when some check leaves the defender this few answers
+const int MATE_SOLVER_REPLIES = 3;
+
+// a build with the trace recorder traces every search of the process into the
+// file XOXO_TRACE_FILE names, the first search starts it
+static void startTraceFromEnvironment() {
+#ifdef XOXO_TRACE
+    static const bool started = [] {
+        const char *path = std::getenv("XOXO_TRACE_FILE");
+        return path != nullptr && xoxo::TraceRecorder::global().start(path);
+    }();
+    (void)started;
+#endif
+}
+
 
 
 std::string ChessSimulator::Move(std::string fen) {
+    return Move(fen, {});
+}
+
+std::string ChessSimulator::Move(std::string fen, const std::vector<std::string> &uciMoves) {
+    return Move(fen, uciMoves, nullptr);
+}
+
+std::string ChessSimulator::Move(std::string fen, const std::vector<std::string> &uciMoves,
+                                 xoxo::SearchControl *control) {
 	// create your board based on the board string following the FEN notation
 	// search for the best move using minimax / monte carlo tree search /
 	// alpha-beta pruning / ... try to use nice heuristics to speed up the search
@@ -17,7 +52,16 @@ std::string ChessSimulator::Move(std::string fen) {
 	// extra points if you create your own board/move representation instead of
 	// using the one provided by the library
 
+    startTraceFromEnvironment();
+
 	chess::Board board(fen);
+    xoxo::RepetitionStack history;
+
+    for (const std::string &uci : uciMoves) {
+        history.push(board.hash());
+        board.makeMove(chess::uci::uciToMove(board, uci));
+    }
+
 	chess::Movelist moves;
     chess::Move move{};
 
@@ -25,11 +69,26 @@ std::string ChessSimulator::Move(std::string fen) {
     if (moves.empty())
         return "";
 
+    // a forced mate is played straight away, there is nothing left for the main search to decide. without memory
+    // for the solver the search below has to find it
+    xoxo::MateSolver *solver =
+        xoxo::hasForcingCheck(board, moves, MATE_SOLVER_REPLIES) ? xoxo::MateSolver::local() : nullptr;
+    if (solver != nullptr) {
+        solver->nodeLimit = MATE_SOLVER_NODES;
+        solver->deadline = std::chrono::steady_clock::now() + MATE_SOLVER_BUDGET;
+
+        chess::Move mate;
+        if (solver->solve(board, history, mate))
+            return chess::uci::moveToUci(mate);
+    }
+
     //if(board.sideToMove() == chess::Color::BLACK)
-    {
+    try {
         xoxo::MCTS mcts(&board);
+        mcts.repetitions = history;
+        mcts.control = control;
 
-        mcts.search(1000);
+        mcts.search(MOVE_ITERATIONS);
 
         xoxo::Node* best = mcts.getBestNode();
 
@@ -37,7 +96,11 @@ std::string ChessSimulator::Move(std::string fen) {
 
         //failsafe in case error
         //if (moves.find(move) != -1 && piece != chess::Piece::NONE)
-        return best->uciString;
+        //a search stopped before its first iteration has nothing to offer, fall back to a random move
+        if (best != nullptr)
+            return best->uciString;
+    } catch (const std::bad_alloc &) {
+        // the memory budget has no room left for even the root, a random move beats forfeiting
     }
 
     // get random move
@@ -50,5 +113,35 @@ std::string ChessSimulator::Move(std::string fen) {
     return chess::uci::moveToUci(move);
 }
 
+ChessSimulator::SearchResult ChessSimulator::Analyse(std::string fen, const SearchLimits &limits) {
+    startTraceFromEnvironment();
 
+    SearchResult result;
+    auto start = std::chrono::steady_clock::now();
 
+    chess::Board board(fen);
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+    if (moves.empty())
+        return result;
+
+    MinMax::SearchContext context;
+    if (limits.depth > 0)
+        context.maxDepth = limits.depth;
+    context.nodeLimit = limits.nodes;
+    if (limits.milliseconds > 0)
+        context.deadline = start + std::chrono::milliseconds(limits.milliseconds);
+
+    chess::Move best = chess::Move::NO_MOVE;
+    result.score = MinMax::searchPosition(board, context, best);
+
+    //not even depth 1 fit in the budget
+    if (best == chess::Move::NO_MOVE)
+        best = moves[0];
+
+    result.move = chess::uci::moveToUci(best);
+    result.nodes = context.nodes;
+    result.depth = context.completedDepth;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
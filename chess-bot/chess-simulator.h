@@ -1,5 +1,11 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
+
+namespace xoxo {
+struct SearchControl;
+}
 
 namespace ChessSimulator {
 /**
@@ -9,4 +15,60 @@ namespace ChessSimulator {
  * @return std::string The move as UCI
  */
 std::string Move(std::string fen);
-} // namespace ChessSimulator
\ No newline at end of file
+
+/**
+ * @brief Move a piece on the board, knowing the moves that led to it
+ *
+ * A bare FEN can't tell the engine which positions were already repeated, the
+ * game history can.
+ *
+ * @param fen The board the game started from as FEN
+ * @param uciMoves The moves played since then as UCI
+ * @return std::string The move as UCI
+ */
+std::string Move(std::string fen, const std::vector<std::string> &uciMoves);
+
+/**
+ * @brief Move a piece on the board from a search that can be watched and
+ * stopped from another thread
+ *
+ * @param fen The board the game started from as FEN
+ * @param uciMoves The moves played since then as UCI
+ * @param control Receives live search snapshots; raising its stop flag ends
+ * the search early with the best move found so far
+ * @return std::string The move as UCI
+ */
+std::string Move(std::string fen, const std::vector<std::string> &uciMoves,
+                 xoxo::SearchControl *control);
+
+/**
+ * @brief Budget of a single analysis, 0 leaves that limit off
+ */
+struct SearchLimits {
+  int depth = 0;
+  uint64_t nodes = 0;
+  int64_t milliseconds = 0;
+};
+
+struct SearchResult {
+  std::string move;
+  // centipawns from the point of view of the side to move
+  int score = 0;
+  uint64_t nodes = 0;
+  int depth = 0;
+  double seconds = 0;
+};
+
+/**
+ * @brief Analyse a position with a bounded alpha-beta search
+ *
+ * Safe to call from many threads at once, they share the transposition
+ * table.
+ *
+ * @param fen The board as FEN
+ * @param limits Depth, node and time budget of the search
+ * @return SearchResult The best move as UCI with its score and search stats,
+ * an empty move if the side to move has none
+ */
+SearchResult Analyse(std::string fen, const SearchLimits &limits);
+} // namespace ChessSimulator
@@ -1,10 +1,225 @@
+#include "AllocationProfiler.h"
+#include "ParseNumber.h"
 #include "chess-simulator.h"
 #include "chess.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
-int main() {
-    std::string fen;
-    getline(std::cin, fen);
-    auto move = ChessSimulator::Move(fen);
-    std::cout << move << std::endl;
-}
\ No newline at end of file
+static void usage() {
+    std::cerr << "usage: chesscli                 reads one FEN from stdin and prints the move\n"
+              << "       chesscli batch [options] reads FENs line by line and prints\n"
+              << "                                fen,move,score,nodes,time in input order\n"
+              << "  --file <path>     read FENs from a file instead of stdin\n"
+              << "  --threads <n>     worker threads (default: all cores)\n"
+              << "  --depth <n>       depth limit per position\n"
+              << "  --nodes <n>       node limit per position\n"
+              << "  --time <ms>       time limit per position\n"
+              << "  --buffer <n>      positions in flight at most (default: 8 per thread)\n"
+              << "  --allocations     report allocations per node on stderr, needs a\n"
+              << "                    build with -DCHESS_ALLOC_PROFILE=ON\n";
+}
+
+namespace {
+
+struct BatchOptions {
+    std::string file;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t buffer = 0;
+    bool allocations = false;
+    ChessSimulator::SearchLimits limits;
+};
+
+// hands positions to the workers and puts their answers back in input order.
+// at most `window` positions are read ahead of the oldest unwritten one, so a
+// slow position holds back the reader instead of growing the buffer
+class BatchQueue {
+public:
+    explicit BatchQueue(size_t window) : window(window), results(window), ready(window, false) {}
+
+    // blocks while the window is full
+    void push(std::string fen) {
+        std::unique_lock lock(mutex);
+        space.wait(lock, [&] { return nextRead - nextWrite < window; });
+        jobs.emplace_back(nextRead++, std::move(fen));
+        work.notify_one();
+    }
+
+    void close() {
+        std::lock_guard lock(mutex);
+        closed = true;
+        work.notify_all();
+    }
+
+    // false when there is nothing left to do
+    bool pop(size_t &index, std::string &fen) {
+        std::unique_lock lock(mutex);
+        work.wait(lock, [&] { return !jobs.empty() || closed; });
+        if (jobs.empty())
+            return false;
+        index = jobs.front().first;
+        fen = std::move(jobs.front().second);
+        jobs.pop_front();
+        return true;
+    }
+
+    // stores a line and writes every line that is now in order
+    void finish(size_t index, std::string line) {
+        std::lock_guard lock(mutex);
+        results[index % window] = std::move(line);
+        ready[index % window] = true;
+
+        bool wrote = false;
+        while (ready[nextWrite % window]) {
+            ready[nextWrite % window] = false;
+            std::cout << results[nextWrite % window] << '\n';
+            nextWrite++;
+            wrote = true;
+        }
+        if (wrote) {
+            std::cout.flush();
+            space.notify_one();
+        }
+    }
+
+private:
+    size_t window;
+    std::mutex mutex;
+    std::condition_variable work;
+    std::condition_variable space;
+    std::deque<std::pair<size_t, std::string>> jobs;
+    std::vector<std::string> results;
+    std::vector<bool> ready;
+    size_t nextRead = 0;
+    size_t nextWrite = 0;
+    bool closed = false;
+};
+
+int runBatch(const BatchOptions &options) {
+    std::ifstream file;
+    if (!options.file.empty()) {
+        file.open(options.file);
+        if (!file) {
+            std::cerr << "cannot open " << options.file << std::endl;
+            return 1;
+        }
+    }
+    std::istream &in = options.file.empty() ? std::cin : file;
+
+    size_t window = options.buffer > 0 ? options.buffer : options.threads * 8;
+    BatchQueue queue(window);
+
+    // allocations are counted per thread, each worker adds its own once the input is done
+    std::mutex statsMutex;
+    xoxo::AllocationStats allocations;
+    uint64_t nodes = 0;
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; t++) {
+        workers.emplace_back([&] {
+            size_t index;
+            std::string fen;
+            uint64_t workerNodes = 0;
+            xoxo::takeAllocationStats();
+
+            while (queue.pop(index, fen)) {
+                auto result = ChessSimulator::Analyse(fen, options.limits);
+                workerNodes += result.nodes;
+                queue.finish(index, fen + "," + result.move + "," + std::to_string(result.score) + "," +
+                                        std::to_string(result.nodes) + "," + std::to_string(result.seconds));
+            }
+
+            std::lock_guard lock(statsMutex);
+            allocations.add(xoxo::takeAllocationStats());
+            nodes += workerNodes;
+        });
+    }
+
+    std::string line;
+    while (getline(in, line)) {
+        // tolerate windows line endings and blank lines
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty())
+            continue;
+        queue.push(line);
+    }
+    queue.close();
+
+    for (auto &worker : workers)
+        worker.join();
+
+    if (options.allocations)
+        std::cerr << allocations.report(nodes);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::string fen;
+        getline(std::cin, fen);
+        auto move = ChessSimulator::Move(fen);
+        std::cout << move << std::endl;
+        return 0;
+    }
+
+    if (std::strcmp(argv[1], "batch") != 0) {
+        usage();
+        return 1;
+    }
+
+    BatchOptions options;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--allocations") {
+            options.allocations = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        bool parsed = true;
+        if (arg == "--file")
+            options.file = value;
+        else if (arg == "--threads")
+            parsed = xoxo::parseNumber(value, options.threads);
+        else if (arg == "--depth")
+            parsed = xoxo::parseNumber(value, options.limits.depth);
+        else if (arg == "--nodes")
+            parsed = xoxo::parseNumber(value, options.limits.nodes);
+        else if (arg == "--time")
+            parsed = xoxo::parseNumber(value, options.limits.milliseconds);
+        else if (arg == "--buffer")
+            parsed = xoxo::parseNumber(value, options.buffer);
+        else
+            parsed = false;
+
+        if (!parsed) {
+            usage();
+            return 1;
+        }
+    }
+    options.threads = std::max(1u, options.threads);
+
+    if (options.allocations && !xoxo::allocationProfiling()) {
+        std::cerr << "--allocations needs chess-bot built with -DCHESS_ALLOC_PROFILE=ON" << std::endl;
+        return 1;
+    }
+
+    // without any budget iterative deepening would never return
+    if (options.limits.depth == 0 && options.limits.nodes == 0 && options.limits.milliseconds == 0)
+        options.limits.depth = 6;
+
+    return runBatch(options);
+}
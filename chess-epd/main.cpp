@@ -0,0 +1,339 @@
+#include "MinMax.h"
+#include "ParseNumber.h"
+#include "PerfCounters.h"
+#include "TranspositionTable.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void usage() {
+    std::fprintf(stderr, "usage: chessepd <suite.epd> [options]\n");
+    std::fprintf(stderr, "  --time <ms>      time per position (default 1000 when no budget is given)\n");
+    std::fprintf(stderr, "  --nodes <n>      node budget per position\n");
+    std::fprintf(stderr, "  --depth <n>      depth limit per position\n");
+    std::fprintf(stderr, "  --threads <n>    positions searched at once (default: all cores)\n");
+    std::fprintf(stderr, "  --format <f>     csv (default) or json\n");
+    std::fprintf(stderr, "  --counters       read the hardware counters around move generation and evaluation\n");
+    std::fprintf(stderr, "  --reproducible   one thread and a cleared transposition table per position, so two builds\n");
+    std::fprintf(stderr, "                   searched with the same --nodes or --depth give outputs that can be diffed\n");
+}
+
+namespace {
+
+struct EpdPosition {
+    std::string id;
+    std::string fen;
+    // SAN as written in the suite, kept for the report
+    std::string expected;
+    std::vector<chess::Move> bestMoves;
+    std::vector<chess::Move> avoidMoves;
+};
+
+struct EpdResult {
+    std::string move;
+    bool solved = false;
+    // when the search settled on a right move for good, -1 if it never did
+    double solveSeconds = -1;
+    uint64_t solveNodes = 0;
+    int depth = 0;
+    uint64_t nodes = 0;
+    double seconds = 0;
+};
+
+bool contains(const std::vector<chess::Move> &moves, chess::Move move) {
+    return std::find(moves.begin(), moves.end(), move) != moves.end();
+}
+
+bool isSolution(const EpdPosition &position, chess::Move move) {
+    if (move == chess::Move::NO_MOVE)
+        return false;
+    if (!position.bestMoves.empty() && !contains(position.bestMoves, move))
+        return false;
+    return !contains(position.avoidMoves, move);
+}
+
+std::string trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+// "<4 fen fields> bm Qg6 Qh5; am Rxe1; id "WAC.001";", false on lines that are not a position
+bool parseEpd(const std::string &line, EpdPosition &position) {
+    std::istringstream fields(line);
+    std::string placement, side, castling, enPassant;
+    if (!(fields >> placement >> side >> castling >> enPassant))
+        return false;
+    position.fen = placement + " " + side + " " + castling + " " + enPassant + " 0 1";
+
+    std::string rest;
+    std::getline(fields, rest);
+
+    chess::Board board(position.fen);
+
+    // operations end with ';', which may also appear inside a quoted id
+    std::vector<std::string> operations;
+    std::string current;
+    bool quoted = false;
+    for (char c : rest) {
+        if (c == '"')
+            quoted = !quoted;
+        if (c == ';' && !quoted) {
+            operations.push_back(trim(current));
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!trim(current).empty())
+        operations.push_back(trim(current));
+
+    for (const std::string &operation : operations) {
+        std::istringstream tokens(operation);
+        std::string opcode;
+        tokens >> opcode;
+
+        if (opcode == "id") {
+            std::string id;
+            std::getline(tokens, id);
+            id = trim(id);
+            if (id.size() >= 2 && id.front() == '"' && id.back() == '"')
+                id = id.substr(1, id.size() - 2);
+            position.id = id;
+        } else if (opcode == "bm" || opcode == "am") {
+            std::string san;
+            while (tokens >> san) {
+                chess::Move move;
+                try {
+                    move = chess::uci::parseSan(board, san);
+                } catch (const std::exception &) {
+                    std::fprintf(stderr, "skipping unparsable move %s in: %s\n", san.c_str(), line.c_str());
+                    continue;
+                }
+                (opcode == "bm" ? position.bestMoves : position.avoidMoves).push_back(move);
+                position.expected += (position.expected.empty() ? "" : " ") + opcode + " " + san;
+            }
+        }
+    }
+
+    return !position.bestMoves.empty() || !position.avoidMoves.empty();
+}
+
+// budget carries the depth and node limits, time is the per position time limit, 0 for none
+EpdResult solve(const EpdPosition &position, const MinMax::SearchContext &budget, std::chrono::milliseconds time) {
+    EpdResult result;
+    auto start = Clock::now();
+
+    chess::Board board(position.fen);
+    MinMax::SearchContext context = budget;
+    if (time.count() > 0)
+        context.deadline = start + time;
+
+    // the solution time is the first iteration after which the answer never changed again
+    bool solvedNow = false;
+    context.onIteration = [&](int, int, chess::Move move) {
+        bool solution = isSolution(position, move);
+        if (solution && !solvedNow) {
+            result.solveSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            result.solveNodes = context.nodes;
+        }
+        solvedNow = solution;
+    };
+
+    chess::Move best = chess::Move::NO_MOVE;
+    MinMax::searchPosition(board, context, best);
+
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    result.move = best == chess::Move::NO_MOVE ? "-" : chess::uci::moveToUci(best);
+    result.solved = isSolution(position, best);
+    if (!result.solved) {
+        result.solveSeconds = -1;
+        result.solveNodes = 0;
+    }
+    result.depth = context.completedDepth;
+    result.nodes = context.nodes;
+    return result;
+}
+
+std::string jsonString(const std::string &text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file) {
+        std::fprintf(stderr, "cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    MinMax::SearchContext budget;
+    long long milliseconds = 0;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string format = "csv";
+    bool counters = false;
+    bool reproducible = false;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--counters") {
+            counters = true;
+            continue;
+        }
+        if (arg == "--reproducible") {
+            reproducible = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        bool parsed = true;
+        if (arg == "--time")
+            parsed = xoxo::parseNumber(value, milliseconds);
+        else if (arg == "--nodes")
+            parsed = xoxo::parseNumber(value, budget.nodeLimit);
+        else if (arg == "--depth")
+            parsed = xoxo::parseNumber(value, budget.maxDepth);
+        else if (arg == "--threads")
+            parsed = xoxo::parseNumber(value, threads);
+        else if (arg == "--format")
+            format = value;
+        else
+            parsed = false;
+
+        if (!parsed) {
+            usage();
+            return 1;
+        }
+    }
+    threads = std::max(1u, threads);
+
+    if (format != "csv" && format != "json") {
+        usage();
+        return 1;
+    }
+
+    xoxo::enablePerfCounters(counters);
+    if (counters && !xoxo::PerfCounters::local().available())
+        std::fprintf(stderr, "hardware counters are not available here, only phase calls are counted\n");
+
+    if (milliseconds == 0 && budget.nodeLimit == 0 && budget.maxDepth == MinMax::SearchContext().maxDepth)
+        milliseconds = 1000;
+
+    // searches on the shared table see what the positions before them, and the other workers, left in it
+    if (reproducible) {
+        threads = 1;
+        if (milliseconds > 0)
+            std::fprintf(stderr, "a time limit depends on the machine, give --nodes or --depth for a reproducible run\n");
+    }
+
+    std::vector<EpdPosition> positions;
+    std::string line;
+    while (std::getline(file, line)) {
+        EpdPosition position;
+        if (trim(line).empty() || !parseEpd(line, position))
+            continue;
+        if (position.id.empty())
+            position.id = std::to_string(positions.size() + 1);
+        positions.push_back(std::move(position));
+    }
+
+    // positions are handed out one at a time so a slow one does not stall a fixed share of the suite
+    std::vector<EpdResult> results(positions.size());
+    std::atomic<size_t> next{0};
+    auto begin = Clock::now();
+    std::mutex totalsMutex;
+    xoxo::PerfTotals totals;
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < std::min<size_t>(threads, positions.size()); t++) {
+        workers.emplace_back([&] {
+            for (size_t i = next++; i < positions.size(); i = next++) {
+                if (reproducible)
+                    xoxo::TranspositionTable::shared().clear();
+                results[i] = solve(positions[i], budget, std::chrono::milliseconds(milliseconds));
+            }
+
+            std::lock_guard lock(totalsMutex);
+            totals.add(xoxo::takePerfTotals());
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    double wall = std::chrono::duration<double>(Clock::now() - begin).count();
+
+    int solved = 0;
+    uint64_t nodes = 0;
+    double searchSeconds = 0;
+    for (const EpdResult &result : results) {
+        solved += result.solved;
+        nodes += result.nodes;
+        searchSeconds += result.seconds;
+    }
+    // nps per search thread, comparable between runs with different thread counts
+    double nps = searchSeconds > 0 ? nodes / searchSeconds : 0;
+
+    if (format == "csv") {
+        std::printf("id,expected,move,solved,solve_seconds,solve_nodes,depth,nodes,seconds\n");
+        for (size_t i = 0; i < positions.size(); i++) {
+            const EpdResult &result = results[i];
+            std::printf("%s,%s,%s,%d,%.4f,%llu,%d,%llu,%.4f\n", positions[i].id.c_str(),
+                        positions[i].expected.c_str(), result.move.c_str(), result.solved ? 1 : 0,
+                        result.solveSeconds, (unsigned long long)result.solveNodes, result.depth,
+                        (unsigned long long)result.nodes, result.seconds);
+        }
+        std::fprintf(stderr, "solved %d/%zu, %llu nodes, %.0f nps, %.2fs wall\n", solved, positions.size(),
+                     (unsigned long long)nodes, nps, wall);
+        if (counters)
+            std::fprintf(stderr, "counters %s\n", totals.json().c_str());
+    } else {
+        std::printf("{\n  \"positions\": [\n");
+        for (size_t i = 0; i < positions.size(); i++) {
+            const EpdResult &result = results[i];
+            std::printf("    {\"id\": %s, \"fen\": %s, \"expected\": %s, \"move\": \"%s\", \"solved\": %s, "
+                        "\"solve_seconds\": %.4f, \"solve_nodes\": %llu, \"depth\": %d, \"nodes\": %llu, "
+                        "\"seconds\": %.4f}%s\n",
+                        jsonString(positions[i].id).c_str(), jsonString(positions[i].fen).c_str(),
+                        jsonString(positions[i].expected).c_str(), result.move.c_str(),
+                        result.solved ? "true" : "false", result.solveSeconds, (unsigned long long)result.solveNodes,
+                        result.depth, (unsigned long long)result.nodes, result.seconds,
+                        i + 1 < positions.size() ? "," : "");
+        }
+        std::printf("  ],\n  \"summary\": {\"positions\": %zu, \"solved\": %d, \"nodes\": %llu, \"nps\": %.0f, "
+                    "\"wall_seconds\": %.3f}",
+                    positions.size(), solved, (unsigned long long)nodes, nps, wall);
+        if (counters)
+            std::printf(",\n  \"counters\": %s", totals.json().c_str());
+        std::printf("\n}\n");
+    }
+
+    return 0;
+}
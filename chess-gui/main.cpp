@@ -24,9 +24,12 @@ EM_JS(int, canvas_get_height, (), { return canvas.height; });
 #include "chess.hpp"
 
 #include "PieceSvg.h"
+#include "SearchControl.h"
 #include "magic_enum/magic_enum.hpp"
+#include <atomic>
 #include <chrono>
 #include <map>
+#include <thread>
 
 enum class SimulationState {
   PAUSED,
@@ -39,9 +42,40 @@ std::chrono::nanoseconds timeSpentOnMoves = std::chrono::nanoseconds::zero();
 std::chrono::nanoseconds timeSpentLastMove = std::chrono::milliseconds::zero();
 string gameResult;
 vector<string> moves;
+// the engine gets the whole game so it can see repetitions
+string startFen;
+vector<string> uciMoves;
+
+// engine worker: searches run off the render thread and report through a
+// lock-free snapshot channel. the web build has no pthreads, there the search
+// runs on the render thread and the frame waits for it
+#ifndef __EMSCRIPTEN__
+std::thread engineThread;
+#endif
+xoxo::SearchControl engineControl;
+// raised by the worker once engineMove holds its answer
+std::atomic<bool> engineDone{false};
+string engineMove;
+// only touched by the render thread
+bool engineRunning = false;
+std::chrono::high_resolution_clock::time_point engineStartTime;
+
+// stops the running search and throws its move away
+void cancelSearch() {
+  if (!engineRunning)
+    return;
+  engineControl.stop = true;
+#ifndef __EMSCRIPTEN__
+  engineThread.join();
+#endif
+  engineRunning = false;
+  engineDone = false;
+}
 
 void reset(chess::Board &board) {
   board = chess::Board();
+  startFen = board.getFen(true);
+  uciMoves.clear();
   simulationState = SimulationState::PAUSED;
   timeSpentOnMoves = std::chrono::nanoseconds::zero();
   timeSpentLastMove = std::chrono::milliseconds::zero();
@@ -50,6 +84,8 @@ void reset(chess::Board &board) {
 }
 
 void move(chess::Board &board) {
+  if (engineRunning)
+    return;
   if (board.isHalfMoveDraw()) {
     auto result = board.getHalfMoveDrawType();
     gameResult = std::string(magic_enum::enum_name(result.second)) + " " +
@@ -65,17 +101,44 @@ void move(chess::Board &board) {
     return;
   }
 
-  std::string turn(magic_enum::enum_name(board.sideToMove().internal()));
   // get stats
-  auto beforeTime = std::chrono::high_resolution_clock::now();
+  engineStartTime = std::chrono::high_resolution_clock::now();
+
+  // run! the move is applied by collectMove once the worker is done
+  engineControl.stop = false;
+  engineDone = false;
+  engineRunning = true;
+#ifdef __EMSCRIPTEN__
+  engineMove = ChessSimulator::Move(startFen, uciMoves, &engineControl);
+  engineDone.store(true, std::memory_order_release);
+#else
+  engineThread = std::thread([fen = startFen, history = uciMoves]() {
+    engineMove = ChessSimulator::Move(fen, history, &engineControl);
+    engineDone.store(true, std::memory_order_release);
+  });
+#endif
+}
+
+void collectMove(chess::Board &board) {
+  if (!engineRunning || !engineDone.load(std::memory_order_acquire))
+    return;
+#ifndef __EMSCRIPTEN__
+  engineThread.join();
+#endif
+  engineRunning = false;
 
-  // run!
-  auto moveStr = ChessSimulator::Move(board.getFen(true));
   // get stats
   auto afterTime = std::chrono::high_resolution_clock::now();
+  auto beforeTime = engineStartTime;
+  auto moveStr = engineMove;
+  if (moveStr.empty())
+    return;
+
+  std::string turn(magic_enum::enum_name(board.sideToMove().internal()));
   // apply move
   auto move = chess::uci::uciToMove(board, moveStr);
   board.makeMove(move);
+  uciMoves.push_back(moveStr);
 
   // update stats
   timeSpentOnMoves += afterTime - beforeTime;
@@ -165,6 +228,7 @@ int main(int argc, char *argv[]) {
   auto piecesTextures = loadPiecesTextures(renderer);
 
   chess::Board board("k7/8/8/8/7p/6pP/PP4Pr/K7 b - - 0 1");
+  startFen = board.getFen(true);
 
   SDL_RendererInfo info;
   SDL_GetRendererInfo(renderer, &info);
@@ -192,6 +256,7 @@ int main(int argc, char *argv[]) {
   while (!done) {
     if (simulationState == SimulationState::RUNNING)
       move(board);
+    collectMove(board);
 
     SDL_Event event;
 
@@ -220,6 +285,7 @@ int main(int argc, char *argv[]) {
     ImGui::Separator();
     if (ImGui::Button("Reset")) {
       simulationState = SimulationState::RUNNING;
+      cancelSearch();
       reset(board);
     }
     ImGui::SameLine();
@@ -235,6 +301,11 @@ int main(int argc, char *argv[]) {
       simulationState = SimulationState::PAUSED;
       move(board);
     }
+    ImGui::SameLine();
+    // the search ends early and its best move so far is played
+    if (ImGui::Button("Stop search")) {
+      engineControl.stop = true;
+    }
     ImGui::Separator();
     // statistics
     ImGui::Text("Acc Time spent: %.3fms", timeSpentOnMoves.count() / 1000000.0);
@@ -251,6 +322,42 @@ int main(int argc, char *argv[]) {
     ImGui::EndChild(); // end child moves
     ImGui::End();      // end settings
 
+    // live search stats, read without ever blocking the worker
+    ImGui::Begin("Search", nullptr);
+    xoxo::SearchSnapshot snapshot;
+    if (engineControl.snapshots.read(snapshot)) {
+      ImGui::Text("State: %s", engineRunning ? "searching" : "idle");
+      ImGui::Text("Iterations: %llu  Depth: %d",
+                  (unsigned long long)snapshot.iterations, snapshot.depth);
+      ImGui::Text("NPS: %.0f  Time: %.3fs", snapshot.nps, snapshot.seconds);
+      ImGui::Text("Best move: %s", snapshot.bestMove);
+      ImGui::Separator();
+      if (ImGui::BeginTable("RootMoves", 4,
+                            ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Move");
+        ImGui::TableSetupColumn("Visits");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableSetupColumn("Prior");
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < snapshot.rootMoveCount; i++) {
+          const auto &info = snapshot.rootMoves[i];
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::Text("%s", info.uci);
+          ImGui::TableNextColumn();
+          ImGui::Text("%d", info.visits);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", info.value);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", info.prior);
+        }
+        ImGui::EndTable();
+      }
+    } else {
+      ImGui::Text("No search yet");
+    }
+    ImGui::End(); // end search
+
     // Rendering
     ImGui::Render();
 
@@ -346,6 +453,7 @@ int main(int argc, char *argv[]) {
   }
 
   // Cleanup
+  cancelSearch();
   ImGui_ImplSDLRenderer_Shutdown();
   ImGui_ImplSDL2_Shutdown();
   ImGui::DestroyContext();
@@ -0,0 +1,193 @@
+#include "MinMax.h"
+#include "PackedPosition.h"
+#include "ParseNumber.h"
+#include "Terminal.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void usage() {
+    std::fprintf(stderr, "usage: chessselfplay --out <file> [options]\n");
+    std::fprintf(stderr, "  --out <file>          packed positions are appended here\n");
+    std::fprintf(stderr, "  --games <n>           games to play (default 1000)\n");
+    std::fprintf(stderr, "  --threads <n>         games played at once (default: all cores)\n");
+    std::fprintf(stderr, "  --nodes <n>           alpha-beta nodes per move (default 5000)\n");
+    std::fprintf(stderr, "  --random-plies <n>    random opening moves before the engine takes over (default 8)\n");
+    std::fprintf(stderr, "  --seed <n>            base seed of the opening randomness\n");
+}
+
+namespace {
+
+// games that get this long are called a draw
+const int MAX_GAME_PLIES = 400;
+
+struct SelfPlayOptions {
+    std::string out;
+    int games = 1000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t nodes = 5000;
+    int randomPlies = 8;
+    uint64_t seed = 0;
+};
+
+// plays one game and hands its positions to buffer once the result is known, returns how many it kept
+int playGame(const SelfPlayOptions &options, std::mt19937_64 &rng, xoxo::PackedPositionBuffer &buffer) {
+    chess::Board board;
+    xoxo::RepetitionStack history;
+
+    for (int ply = 0; ply < options.randomPlies; ply++) {
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, board);
+        if (moves.empty())
+            return 0;
+
+        history.push(board.hash());
+        board.makeMove(moves[static_cast<int>(rng() % moves.size())]);
+    }
+
+    std::vector<xoxo::PackedPosition> positions;
+    int result = 0;
+
+    for (int ply = 0; ply < MAX_GAME_PLIES; ply++) {
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, board);
+        xoxo::Terminal terminal = xoxo::getTerminal(board, moves, &history);
+
+        if (terminal == xoxo::Terminal::CHECKMATE) {
+            result = board.sideToMove() == chess::Color::WHITE ? -1 : 1;
+            break;
+        }
+        if (terminal != xoxo::Terminal::NONE)
+            break;
+
+        MinMax::SearchContext context;
+        context.nodeLimit = options.nodes;
+        context.repetitions = &history;
+
+        chess::Move best = chess::Move::NO_MOVE;
+        int score = MinMax::searchPosition(board, context, best);
+        if (best == chess::Move::NO_MOVE)
+            best = moves[0];
+
+        int whiteScore = board.sideToMove() == chess::Color::WHITE ? score : -score;
+
+        // a found mate decides the game, playing it out adds nothing to learn from
+        if (std::abs(score) >= MATE_BOUND) {
+            result = whiteScore > 0 ? 1 : -1;
+            break;
+        }
+
+        // only quiet positions, a static evaluation cannot be expected to see through checks and captures
+        if (!board.inCheck() && !board.isCapture(best))
+            positions.push_back(xoxo::packPosition(board, whiteScore, 0));
+
+        history.push(board.hash());
+        board.makeMove(best);
+    }
+
+    for (xoxo::PackedPosition &position : positions) {
+        position.result = static_cast<int8_t>(result);
+        buffer.push(position);
+    }
+
+    return static_cast<int>(positions.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    SelfPlayOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        bool parsed = true;
+        if (arg == "--out")
+            options.out = value;
+        else if (arg == "--games")
+            parsed = xoxo::parseNumber(value, options.games);
+        else if (arg == "--threads")
+            parsed = xoxo::parseNumber(value, options.threads);
+        else if (arg == "--nodes")
+            parsed = xoxo::parseNumber(value, options.nodes);
+        else if (arg == "--random-plies")
+            parsed = xoxo::parseNumber(value, options.randomPlies);
+        else if (arg == "--seed")
+            parsed = xoxo::parseNumber(value, options.seed);
+        else
+            parsed = false;
+
+        if (!parsed) {
+            usage();
+            return 1;
+        }
+    }
+    options.threads = std::max(1u, options.threads);
+
+    if (options.out.empty()) {
+        usage();
+        return 1;
+    }
+
+    xoxo::PackedPositionWriter writer(options.out);
+    if (!writer.isOpen()) {
+        std::fprintf(stderr, "cannot open %s\n", options.out.c_str());
+        return 1;
+    }
+
+    std::atomic<int> nextGame{0};
+    std::atomic<int> gamesDone{0};
+    std::atomic<unsigned> running{options.threads};
+    auto begin = Clock::now();
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(options.seed * 0x9E3779B97F4A7C15ULL + t);
+            xoxo::PackedPositionBuffer buffer(writer);
+
+            while (nextGame++ < options.games) {
+                playGame(options, rng, buffer);
+                gamesDone++;
+            }
+
+            buffer.flush();
+            running--;
+        });
+    }
+
+    // progress every few seconds, positions only count once their buffer was flushed
+    while (running > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        static auto lastReport = begin;
+        if (Clock::now() - lastReport >= std::chrono::seconds(5)) {
+            lastReport = Clock::now();
+            double seconds = std::chrono::duration<double>(lastReport - begin).count();
+            std::fprintf(stderr, "%d/%d games, %llu positions written, %.0f positions/s\n", gamesDone.load(),
+                         options.games, (unsigned long long)writer.written(), writer.written() / seconds);
+        }
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    std::fprintf(stderr, "done: %d games, %llu positions in %.1fs, %.0f positions/s\n", gamesDone.load(),
+                 (unsigned long long)writer.written(), seconds, writer.written() / seconds);
+    return 0;
+}
@@ -0,0 +1,358 @@
+#include "MCTS.h"
+#include "Params.h"
+#include "ParseNumber.h"
+#include "Terminal.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void usage() {
+    std::fprintf(stderr, "usage: chessspsa [options]\n");
+    std::fprintf(stderr, "  --iterations <n>       perturbed game pairs to play (default 2000)\n");
+    std::fprintf(stderr, "  --threads <n>          pairs played at once (default: all cores)\n");
+    std::fprintf(stderr, "  --playouts <n>         MCTS iterations per move (default 300)\n");
+    std::fprintf(stderr, "  --policy <puct|ucb1>   MCTS selection policy the games use (default puct)\n");
+    std::fprintf(stderr, "  --params <a,b,...>     parameters to tune (default: every one the policy reads)\n");
+    std::fprintf(stderr, "  --rate <x>             SPSA learning rate, share of a perturbation moved per game point (default 0.05)\n");
+    std::fprintf(stderr, "  --checkpoint <file>    parameter trajectory CSV, resumed from when it exists (default spsa.csv)\n");
+    std::fprintf(stderr, "  --every <n>            pairs between checkpoint rows (default 50)\n");
+    std::fprintf(stderr, "  --random-plies <n>     random opening moves shared by both games of a pair (default 6)\n");
+    std::fprintf(stderr, "  --seed <n>             base seed of openings and perturbations\n");
+}
+
+namespace {
+
+// games that get this long are called a draw
+const int MAX_GAME_PLIES = 300;
+// SPSA schedule exponents and stability constant, the usual values from Spall
+const double ALPHA = 0.602;
+const double GAMMA = 0.101;
+const double STABILITY = 100.0;
+
+struct SpsaOptions {
+    int iterations = 2000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    int playouts = 300;
+    xoxo::SelectionPolicy policy = xoxo::SelectionPolicy::PUCT;
+    std::vector<xoxo::Param> params;
+    double rate = 0.05;
+    std::string checkpoint = "spsa.csv";
+    int every = 50;
+    int randomPlies = 6;
+    uint64_t seed = 0;
+};
+
+// the values being tuned, shared by all workers
+struct SpsaState {
+    std::mutex mutex;
+    xoxo::ParamSet theta;
+    int iteration = 0;
+    int pairsDone = 0;
+    // game points of the plus side over every pair so far
+    double score = 0.0;
+};
+
+// the games play rollouts, so the draw value always matters, while each exploration constant belongs to one policy
+bool readByPolicy(xoxo::Param param, xoxo::SelectionPolicy policy) {
+    switch (param) {
+    case xoxo::Param::PUCT_EXPLORATION:
+        return policy == xoxo::SelectionPolicy::PUCT;
+    case xoxo::Param::UCB_EXPLORATION:
+    case xoxo::Param::RAVE_EQUIVALENCE:
+        return policy == xoxo::SelectionPolicy::UCB1;
+    default:
+        return true;
+    }
+}
+
+// result from white's point of view: 1, 0 or -1
+int playGame(const std::vector<chess::Move> &opening, const xoxo::ParamSet &white, const xoxo::ParamSet &black,
+             const SpsaOptions &options) {
+    chess::Board board;
+    xoxo::RepetitionStack history;
+
+    for (const chess::Move &move : opening) {
+        history.push(board.hash());
+        board.makeMove(move);
+    }
+
+    for (int ply = 0; ply < MAX_GAME_PLIES; ply++) {
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, board);
+        xoxo::Terminal terminal = xoxo::getTerminal(board, moves, &history);
+
+        if (terminal == xoxo::Terminal::CHECKMATE)
+            return board.sideToMove() == chess::Color::WHITE ? -1 : 1;
+        if (terminal != xoxo::Terminal::NONE)
+            return 0;
+
+        xoxo::ScopedParams scoped(board.sideToMove() == chess::Color::WHITE ? white : black);
+        xoxo::MCTS mcts(&board);
+        mcts.repetitions = history;
+        mcts.selectionPolicy = options.policy;
+        mcts.search(options.playouts);
+
+        xoxo::Node *best = mcts.getBestNode();
+        chess::Move move = best != nullptr ? best->move : moves[0];
+
+        history.push(board.hash());
+        board.makeMove(move);
+    }
+
+    return 0;
+}
+
+std::vector<chess::Move> randomOpening(std::mt19937_64 &rng, int plies) {
+    chess::Board board;
+    std::vector<chess::Move> opening;
+
+    for (int ply = 0; ply < plies; ply++) {
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, board);
+        if (moves.empty())
+            break;
+
+        chess::Move move = moves[static_cast<int>(rng() % moves.size())];
+        opening.push_back(move);
+        board.makeMove(move);
+    }
+
+    return opening;
+}
+
+std::string header(const SpsaOptions &options) {
+    std::string line = "iteration,pairs,score";
+    for (xoxo::Param param : options.params)
+        line += std::string(",") + xoxo::paramInfo(param).name;
+    return line;
+}
+
+void writeRow(std::ofstream &out, const SpsaState &state, const SpsaOptions &options) {
+    out << state.iteration << ',' << state.pairsDone << ',' << state.score;
+    for (xoxo::Param param : options.params)
+        out << ',' << state.theta[param];
+    out << '\n';
+    out.flush();
+}
+
+enum class Resume { NONE, RESUMED, UNREADABLE };
+
+// picks the run up from the last row of an earlier checkpoint. the checkpoint is kept in header, its columns have
+// to match the parameters of this run
+Resume resume(const std::string &path, SpsaState &state, std::string &header) {
+    std::ifstream in(path);
+    std::string line, last;
+    if (!std::getline(in, header))
+        return Resume::NONE;
+    while (std::getline(in, line)) {
+        if (!line.empty())
+            last = line;
+    }
+    if (last.empty())
+        return Resume::NONE;
+
+    std::vector<std::string> names, values;
+    std::string field;
+    for (std::istringstream fields(header); std::getline(fields, field, ',');)
+        names.push_back(field);
+    for (std::istringstream fields(last); std::getline(fields, field, ',');)
+        values.push_back(field);
+
+    for (size_t i = 0; i < std::min(names.size(), values.size()); i++) {
+        double value = 0;
+        bool parsed = true;
+        if (names[i] == "iteration")
+            parsed = xoxo::parseNumber(values[i], state.iteration);
+        else if (names[i] == "pairs")
+            parsed = xoxo::parseNumber(values[i], state.pairsDone);
+        else if (names[i] == "score")
+            parsed = xoxo::parseNumber(values[i], state.score);
+        else if (xoxo::Param param = xoxo::findParam(names[i]); param != xoxo::Param::COUNT) {
+            parsed = xoxo::parseNumber(values[i], value);
+            if (parsed)
+                state.theta.set(param, value);
+        }
+
+        if (!parsed)
+            return Resume::UNREADABLE;
+    }
+
+    return Resume::RESUMED;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    SpsaOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        bool parsed = true;
+        if (arg == "--iterations")
+            parsed = xoxo::parseNumber(value, options.iterations);
+        else if (arg == "--threads")
+            parsed = xoxo::parseNumber(value, options.threads);
+        else if (arg == "--playouts")
+            parsed = xoxo::parseNumber(value, options.playouts);
+        else if (arg == "--policy" && (value == "puct" || value == "ucb1"))
+            options.policy = value == "puct" ? xoxo::SelectionPolicy::PUCT : xoxo::SelectionPolicy::UCB1;
+        else if (arg == "--rate")
+            parsed = xoxo::parseNumber(value, options.rate);
+        else if (arg == "--checkpoint")
+            options.checkpoint = value;
+        else if (arg == "--every")
+            parsed = xoxo::parseNumber(value, options.every);
+        else if (arg == "--random-plies")
+            parsed = xoxo::parseNumber(value, options.randomPlies);
+        else if (arg == "--seed")
+            parsed = xoxo::parseNumber(value, options.seed);
+        else if (arg == "--params") {
+            std::string name;
+            for (std::istringstream names(value); std::getline(names, name, ',');) {
+                xoxo::Param param = xoxo::findParam(name);
+                if (param == xoxo::Param::COUNT) {
+                    std::fprintf(stderr, "unknown parameter %s\n", name.c_str());
+                    return 1;
+                }
+                options.params.push_back(param);
+            }
+        } else
+            parsed = false;
+
+        if (!parsed) {
+            usage();
+            return 1;
+        }
+    }
+    options.threads = std::max(1u, options.threads);
+    options.playouts = std::max(1, options.playouts);
+    options.every = std::max(1, options.every);
+
+    if (options.params.empty()) {
+        for (int i = 0; i < xoxo::PARAM_COUNT; i++) {
+            if (readByPolicy(static_cast<xoxo::Param>(i), options.policy))
+                options.params.push_back(static_cast<xoxo::Param>(i));
+        }
+    }
+
+    // perturbing a parameter the games never read only adds noise to the others
+    for (xoxo::Param param : options.params) {
+        if (!readByPolicy(param, options.policy)) {
+            std::fprintf(stderr, "%s is not read by the %s policy\n", xoxo::paramInfo(param).name,
+                         options.policy == xoxo::SelectionPolicy::PUCT ? "puct" : "ucb1");
+            return 1;
+        }
+    }
+
+    SpsaState state;
+    std::string previousHeader;
+    Resume resumedFrom = resume(options.checkpoint, state, previousHeader);
+    if (resumedFrom == Resume::UNREADABLE) {
+        std::fprintf(stderr, "cannot read the last row of %s\n", options.checkpoint.c_str());
+        return 1;
+    }
+    bool resumed = resumedFrom == Resume::RESUMED;
+    if (resumed && previousHeader != header(options)) {
+        std::fprintf(stderr, "%s tracks other parameters: %s\n", options.checkpoint.c_str(), previousHeader.c_str());
+        return 1;
+    }
+
+    std::ofstream checkpoint(options.checkpoint, std::ios::app);
+    if (!checkpoint) {
+        std::fprintf(stderr, "cannot open %s\n", options.checkpoint.c_str());
+        return 1;
+    }
+
+    if (resumed) {
+        std::fprintf(stderr, "resuming from %s at iteration %d\n", options.checkpoint.c_str(), state.iteration);
+    } else {
+        checkpoint << header(options) << '\n';
+        writeRow(checkpoint, state, options);
+    }
+
+    const int firstIteration = state.iteration;
+    const int firstPairs = state.pairsDone;
+    const int lastIteration = firstIteration + options.iterations;
+    auto begin = Clock::now();
+
+    // asynchronous SPSA: every worker draws its own perturbation of the current values, plays a pair with it and
+    // applies its update as soon as the pair is over, so no worker waits for the slowest game of a round
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < options.threads; t++) {
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(options.seed * 0x9E3779B97F4A7C15ULL + firstIteration * 7919ULL + t);
+
+            while (true) {
+                int k;
+                xoxo::ParamSet plus, minus;
+                std::vector<double> delta(options.params.size()), step(options.params.size());
+
+                {
+                    std::lock_guard lock(state.mutex);
+                    if (state.iteration >= lastIteration)
+                        return;
+                    k = state.iteration++;
+
+                    plus = state.theta;
+                    minus = state.theta;
+                    for (size_t p = 0; p < options.params.size(); p++) {
+                        xoxo::Param param = options.params[p];
+                        delta[p] = (rng() & 1) ? 1.0 : -1.0;
+                        step[p] = xoxo::paramInfo(param).step / std::pow(k + 1.0, GAMMA);
+                        plus.set(param, state.theta[param] + step[p] * delta[p]);
+                        minus.set(param, state.theta[param] - step[p] * delta[p]);
+                    }
+                }
+
+                // both colors from the same opening, so the opening's bias cancels out
+                std::vector<chess::Move> opening = randomOpening(rng, options.randomPlies);
+                int result = playGame(opening, plus, minus, options) - playGame(opening, minus, plus, options);
+
+                std::lock_guard lock(state.mutex);
+                double gain = options.rate * std::pow(STABILITY + 1.0, ALPHA) / std::pow(STABILITY + k + 1.0, ALPHA);
+                for (size_t p = 0; p < options.params.size(); p++) {
+                    xoxo::Param param = options.params[p];
+                    state.theta.set(param, state.theta[param] + gain * step[p] * result * delta[p]);
+                }
+
+                state.pairsDone++;
+                state.score += result;
+
+                if (state.pairsDone % options.every == 0) {
+                    writeRow(checkpoint, state, options);
+                    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+                    std::fprintf(stderr, "%d pairs, %.1f games/s, plus side scored %+.0f\n", state.pairsDone,
+                                 2.0 * (state.pairsDone - firstPairs) / seconds, state.score);
+                }
+            }
+        });
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+    writeRow(checkpoint, state, options);
+
+    for (xoxo::Param param : options.params)
+        std::printf("%s %g\n", xoxo::paramInfo(param).name, state.theta[param]);
+
+    return 0;
+}
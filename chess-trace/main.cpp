@@ -0,0 +1,243 @@
+#include "ParseNumber.h"
+#include "SearchTrace.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+static void usage() {
+    std::fprintf(stderr, "usage: chesstrace <file> [options]\n");
+    std::fprintf(stderr, "  reads a trace written by a chess-bot built with -DCHESS_TRACE=ON and run with\n");
+    std::fprintf(stderr, "  XOXO_TRACE_FILE=<file>, and prints one summary line per search\n");
+    std::fprintf(stderr, "  --dump              print every record instead\n");
+    std::fprintf(stderr, "  --thread <n>        only the searches of this thread\n");
+    std::fprintf(stderr, "  --top <n>           root moves listed per MCTS search (default 5)\n");
+    std::fprintf(stderr, "  --nested            also print the alpha-beta searches MCTS runs at its leaves\n");
+}
+
+namespace {
+
+const char *EVENT_NAMES[] = {"begin", "end", "select", "expand", "playout", "cutoff", "iteration"};
+
+struct TraceOptions {
+    std::string file;
+    bool dump = false;
+    int thread = -1;
+    int top = 5;
+    bool nested = false;
+};
+
+struct Traced {
+    uint32_t thread;
+    xoxo::TraceRecord record;
+};
+
+std::string moveName(uint16_t move) {
+    return move == 0 ? "-" : chess::uci::moveToUci(chess::Move(move));
+}
+
+// what one search did, collected from its begin record to its end record
+struct SearchSummary {
+    uint64_t root = 0;
+    uint32_t begin = 0;
+    uint64_t selections = 0;
+    uint64_t depthSum = 0;
+    int maxDepth = 0;
+    uint64_t expansions = 0;
+    uint64_t playouts = 0;
+    double playoutValue = 0;
+    std::map<uint16_t, uint64_t> rootMoves;
+    uint64_t cutoffs = 0;
+    uint64_t firstMoveCutoffs = 0;
+    // alpha-beta searches run inside this one, MCTS leaves evaluated by search
+    uint64_t leafSearches = 0;
+    std::vector<xoxo::TraceRecord> iterations;
+
+    void add(const xoxo::TraceRecord &record) {
+        switch (record.event) {
+        case xoxo::TraceEvent::SELECT:
+            selections++;
+            depthSum += record.depth;
+            maxDepth = std::max<int>(maxDepth, record.depth);
+            rootMoves[record.move]++;
+            break;
+        case xoxo::TraceEvent::EXPAND:
+            expansions++;
+            break;
+        case xoxo::TraceEvent::PLAYOUT:
+            playouts++;
+            playoutValue += record.value / 1000.0;
+            break;
+        case xoxo::TraceEvent::CUTOFF:
+            cutoffs++;
+            firstMoveCutoffs += record.count == 0;
+            break;
+        case xoxo::TraceEvent::ITERATION:
+            iterations.push_back(record);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void print(uint32_t thread, const xoxo::TraceRecord &end, int top) const {
+        std::printf("thread %u %016llx %8.1f ms", thread, (unsigned long long)root, (end.time - begin) / 1000.0);
+
+        // alpha-beta searches leave iterations, MCTS searches selections
+        if (selections == 0 && (!iterations.empty() || cutoffs > 0)) {
+            std::printf("  alpha-beta depth %d, %u nodes, best %s %d, %llu cutoffs, %.1f%% on the first move\n",
+                        end.depth, end.count, moveName(end.move).c_str(), end.value, (unsigned long long)cutoffs,
+                        cutoffs > 0 ? 100.0 * firstMoveCutoffs / cutoffs : 0.0);
+            for (const xoxo::TraceRecord &iteration : iterations)
+                std::printf("    depth %2d %-6s %7d at %.1f ms\n", iteration.depth, moveName(iteration.move).c_str(),
+                            iteration.value, (iteration.time - begin) / 1000.0);
+            return;
+        }
+
+        std::printf("  mcts %u iterations, %llu expansions, depth %.1f mean %d max, playouts %.3f mean\n", end.count,
+                    (unsigned long long)expansions, selections > 0 ? static_cast<double>(depthSum) / selections : 0.0,
+                    maxDepth, playouts > 0 ? playoutValue / playouts : 0.0);
+        if (leafSearches > 0)
+            std::printf("    %llu leaf searches, %llu cutoffs, %.1f%% on the first move\n",
+                        (unsigned long long)leafSearches, (unsigned long long)cutoffs,
+                        cutoffs > 0 ? 100.0 * firstMoveCutoffs / cutoffs : 0.0);
+
+        std::vector<std::pair<uint64_t, uint16_t>> ranked;
+        for (const auto &[move, count] : rootMoves)
+            ranked.emplace_back(count, move);
+        std::sort(ranked.rbegin(), ranked.rend());
+
+        for (int i = 0; i < std::min<int>(top, static_cast<int>(ranked.size())); i++)
+            std::printf("    %-6s %8llu selections %5.1f%%\n", moveName(ranked[i].second).c_str(),
+                        (unsigned long long)ranked[i].first, 100.0 * ranked[i].first / std::max<uint64_t>(1, selections));
+    }
+};
+
+bool readTrace(const std::string &path, std::vector<Traced> &records) {
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    char magic[sizeof(xoxo::TRACE_MAGIC)];
+    if (std::fread(magic, sizeof(magic), 1, file) != 1 || std::memcmp(magic, xoxo::TRACE_MAGIC, sizeof(magic)) != 0) {
+        std::fclose(file);
+        return false;
+    }
+
+    xoxo::TraceBlockHeader header;
+    while (std::fread(&header, sizeof(header), 1, file) == 1) {
+        std::vector<xoxo::TraceRecord> block(header.count);
+        size_t read = std::fread(block.data(), sizeof(xoxo::TraceRecord), header.count, file);
+
+        // a trace cut short by a crash still has every complete record before the cut
+        for (size_t i = 0; i < read; i++)
+            records.push_back({header.thread, block[i]});
+        if (read < header.count)
+            break;
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    TraceOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        bool parsed = true;
+        if (arg == "--dump")
+            options.dump = true;
+        else if (arg == "--thread" && i + 1 < argc)
+            parsed = xoxo::parseNumber(argv[++i], options.thread);
+        else if (arg == "--nested")
+            options.nested = true;
+        else if (arg == "--top" && i + 1 < argc)
+            parsed = xoxo::parseNumber(argv[++i], options.top);
+        else if (options.file.empty() && arg.rfind("--", 0) != 0)
+            options.file = arg;
+        else
+            parsed = false;
+
+        if (!parsed) {
+            usage();
+            return 1;
+        }
+    }
+
+    if (options.file.empty()) {
+        usage();
+        return 1;
+    }
+
+    std::vector<Traced> records;
+    if (!readTrace(options.file, records)) {
+        std::fprintf(stderr, "%s is not a trace file\n", options.file.c_str());
+        return 1;
+    }
+
+    // blocks of different threads interleave in the file, each thread's own records are in order
+    std::stable_sort(records.begin(), records.end(),
+                     [](const Traced &a, const Traced &b) { return a.record.time < b.record.time; });
+
+    // per thread, the searches that have begun and not ended yet, innermost last
+    std::map<uint32_t, std::vector<SearchSummary>> running;
+    int searches = 0;
+
+    for (const Traced &traced : records) {
+        const xoxo::TraceRecord &record = traced.record;
+        if (options.thread >= 0 && traced.thread != static_cast<uint32_t>(options.thread))
+            continue;
+        if (record.event >= xoxo::TraceEvent::COUNT)
+            continue;
+
+        if (options.dump) {
+            std::printf("%10u %3u %-9s %016llx %-6s %3u %8d %10u\n", record.time, traced.thread,
+                        EVENT_NAMES[static_cast<int>(record.event)], (unsigned long long)record.key,
+                        moveName(record.move).c_str(), record.depth, record.value, record.count);
+            continue;
+        }
+
+        std::vector<SearchSummary> &stack = running[traced.thread];
+
+        if (record.event == xoxo::TraceEvent::SEARCH_BEGIN) {
+            stack.emplace_back();
+            stack.back().root = record.key;
+            stack.back().begin = record.time;
+            continue;
+        }
+
+        // the recorder was started in the middle of this search
+        if (stack.empty())
+            continue;
+
+        if (record.event != xoxo::TraceEvent::SEARCH_END) {
+            stack.back().add(record);
+            continue;
+        }
+
+        SearchSummary summary = std::move(stack.back());
+        stack.pop_back();
+        searches++;
+
+        if (!stack.empty()) {
+            stack.back().leafSearches++;
+            stack.back().cutoffs += summary.cutoffs;
+            stack.back().firstMoveCutoffs += summary.firstMoveCutoffs;
+        }
+
+        if (stack.empty() || options.nested)
+            summary.print(traced.thread, record, options.top);
+    }
+
+    if (!options.dump)
+        std::printf("%zu records, %d searches\n", records.size(), searches);
+
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include "EvalTables.h"
+#include "MinMax.h"
+#include "PackedPosition.h"
+#include "ParseNumber.h"
+#include "chess.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static void usage() {
+    std::fprintf(stderr, "usage: chesstune <positions.bin> [options]\n");
+    std::fprintf(stderr, "  --out <file>       where the tuned tables are written (default EvalTables.tuned.h)\n");
+    std::fprintf(stderr, "  --epochs <n>       gradient descent steps, each a full pass over the data (default 300)\n");
+    std::fprintf(stderr, "  --rate <x>         Adam step size in centipawns (default 1.0)\n");
+    std::fprintf(stderr, "  --lambda <x>       weight of the game result against the search score in the target (default 1.0)\n");
+    std::fprintf(stderr, "  --threads <n>      worker threads (default: all cores)\n");
+    std::fprintf(stderr, "  --limit <n>        only use the first n positions\n");
+}
+
+namespace {
+
+const int PIECE_SQUARE_WEIGHTS = 6 * 64;
+// the six piece-square tables in chess::PieceType order, then the material of everything but the king
+const int WEIGHT_COUNT = PIECE_SQUARE_WEIGHTS + 5;
+// positions decoded and evaluated together, every feature is a column over the block
+const int BLOCK = 256;
+const int MAX_PIECES = 32;
+
+const char *TABLE_NAMES[6] = {"pawnValues", "knightValues", "bishopValues", "rookValues", "queenValues", "kingValues"};
+int *const TABLES[6] = {pawnValues, knightValues, bishopValues, rookValues, queenValues, kingValues};
+
+struct TuneOptions {
+    std::string data;
+    std::string out = "EvalTables.tuned.h";
+    int epochs = 300;
+    double rate = 1.0;
+    float lambda = 1.0f;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t limit = 0;
+};
+
+struct Dataset {
+    const xoxo::PackedPosition *records = nullptr;
+    size_t size = 0;
+    // the part of the evaluation that is not tuned, pawn structure from white's point of view
+    std::vector<int16_t> offsets;
+};
+
+// a block of positions in columns, lane i of every array belongs to the same position
+struct Block {
+    int count = 0;
+    // weight index and sign of every piece, padded with zero signs
+    alignas(64) int32_t index[MAX_PIECES][BLOCK];
+    alignas(64) float sign[MAX_PIECES][BLOCK];
+    // white minus black piece counts
+    alignas(64) float material[5][BLOCK];
+    alignas(64) float eval[BLOCK];
+    alignas(64) float target[BLOCK];
+    alignas(64) float gradient[BLOCK];
+};
+
+float sigmoid(float k, float score) {
+    return 1.0f / (1.0f + std::exp(-k * score));
+}
+
+void decode(Block &block, const Dataset &dataset, size_t begin, size_t end, float k, float lambda) {
+    block.count = static_cast<int>(end - begin);
+
+    for (int lane = 0; lane < block.count; lane++) {
+        const xoxo::PackedPosition &record = dataset.records[begin + lane];
+        for (int type = 0; type < 5; type++)
+            block.material[type][lane] = 0.0f;
+
+        int slot = 0;
+        int nibble = 0;
+        for (uint64_t bits = record.occupancy; bits != 0 && slot < MAX_PIECES; bits &= bits - 1, nibble++) {
+            int piece = (record.pieces[nibble / 2] >> (nibble % 2 * 4)) & 0xF;
+            if (piece > 11)
+                continue;
+
+            int square = std::countr_zero(bits);
+            int type = piece % 6;
+            bool white = piece < 6;
+
+            // same layout as the engine tables, rank 8 first as white sees the board
+            block.index[slot][lane] = type * 64 + (white ? square ^ 56 : square);
+            block.sign[slot][lane] = white ? 1.0f : -1.0f;
+            slot++;
+
+            if (type < 5)
+                block.material[type][lane] += white ? 1.0f : -1.0f;
+        }
+
+        for (; slot < MAX_PIECES; slot++) {
+            block.index[slot][lane] = 0;
+            block.sign[slot][lane] = 0.0f;
+        }
+
+        float result = (record.result + 1) * 0.5f;
+        block.target[lane] = lambda * result + (1.0f - lambda) * sigmoid(k, record.score);
+        block.eval[lane] = dataset.offsets[begin + lane];
+    }
+}
+
+// adds the block's squared error to loss and, when gradient is given, its derivative by every weight
+void evaluate(Block &block, const float *weights, float k, double &loss, double *gradient) {
+    const int count = block.count;
+
+    for (int slot = 0; slot < MAX_PIECES; slot++) {
+        const int32_t *index = block.index[slot];
+        const float *sign = block.sign[slot];
+        for (int lane = 0; lane < count; lane++)
+            block.eval[lane] += sign[lane] * weights[index[lane]];
+    }
+
+    for (int type = 0; type < 5; type++) {
+        const float weight = weights[PIECE_SQUARE_WEIGHTS + type];
+        const float *material = block.material[type];
+        for (int lane = 0; lane < count; lane++)
+            block.eval[lane] += weight * material[lane];
+    }
+
+    float blockLoss = 0.0f;
+    for (int lane = 0; lane < count; lane++) {
+        float s = sigmoid(k, block.eval[lane]);
+        float error = s - block.target[lane];
+        blockLoss += error * error;
+        block.gradient[lane] = 2.0f * error * s * (1.0f - s) * k;
+    }
+    loss += blockLoss;
+
+    if (gradient == nullptr)
+        return;
+
+    for (int slot = 0; slot < MAX_PIECES; slot++) {
+        const int32_t *index = block.index[slot];
+        const float *sign = block.sign[slot];
+        for (int lane = 0; lane < count; lane++)
+            gradient[index[lane]] += block.gradient[lane] * sign[lane];
+    }
+
+    for (int type = 0; type < 5; type++) {
+        const float *material = block.material[type];
+        double sum = 0.0;
+        for (int lane = 0; lane < count; lane++)
+            sum += block.gradient[lane] * material[lane];
+        gradient[PIECE_SQUARE_WEIGHTS + type] += sum;
+    }
+}
+
+// mean squared error over the whole dataset, gradient (if given) receives the mean derivative
+double pass(const Dataset &dataset, const std::vector<float> &weights, float k, const TuneOptions &options,
+            std::vector<double> *gradient) {
+    unsigned threads = options.threads;
+    std::vector<double> losses(threads, 0.0);
+    std::vector<std::vector<double>> gradients(gradient != nullptr ? threads : 0,
+                                               std::vector<double>(WEIGHT_COUNT, 0.0));
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            auto block = std::make_unique<Block>();
+            size_t begin = dataset.size * t / threads;
+            size_t end = dataset.size * (t + 1) / threads;
+            double *threadGradient = gradient != nullptr ? gradients[t].data() : nullptr;
+
+            for (size_t i = begin; i < end; i += BLOCK) {
+                decode(*block, dataset, i, std::min(end, i + BLOCK), k, options.lambda);
+                evaluate(*block, weights.data(), k, losses[t], threadGradient);
+            }
+        });
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+
+    double loss = 0.0;
+    for (double threadLoss : losses)
+        loss += threadLoss;
+
+    if (gradient != nullptr) {
+        gradient->assign(WEIGHT_COUNT, 0.0);
+        for (const auto &threadGradient : gradients) {
+            for (int w = 0; w < WEIGHT_COUNT; w++)
+                (*gradient)[w] += threadGradient[w] / dataset.size;
+        }
+    }
+
+    return loss / dataset.size;
+}
+
+// the scaling constant that makes the starting weights predict the results best, golden section search
+float fitScaling(const Dataset &dataset, const std::vector<float> &weights, const TuneOptions &options) {
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = 0.0005, high = 0.05;
+    double a = high - ratio * (high - low), b = low + ratio * (high - low);
+    double lossA = pass(dataset, weights, a, options, nullptr);
+    double lossB = pass(dataset, weights, b, options, nullptr);
+
+    for (int i = 0; i < 24; i++) {
+        if (lossA < lossB) {
+            high = b;
+            b = a;
+            lossB = lossA;
+            a = high - ratio * (high - low);
+            lossA = pass(dataset, weights, a, options, nullptr);
+        } else {
+            low = a;
+            a = b;
+            lossA = lossB;
+            b = low + ratio * (high - low);
+            lossB = pass(dataset, weights, b, options, nullptr);
+        }
+    }
+
+    return static_cast<float>((low + high) / 2.0);
+}
+
+// the pawn structure is computed once per position, it goes through the engine and so needs a real board
+void computeOffsets(Dataset &dataset, unsigned threads) {
+    dataset.offsets.resize(dataset.size);
+    std::atomic<size_t> next{0};
+    const size_t chunk = 4096;
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            chess::Board board;
+            for (size_t begin = next.fetch_add(chunk); begin < dataset.size; begin = next.fetch_add(chunk)) {
+                for (size_t i = begin; i < std::min(dataset.size, begin + chunk); i++) {
+                    board.setFen(xoxo::unpackFen(dataset.records[i]));
+                    dataset.offsets[i] = static_cast<int16_t>(std::clamp(MinMax::getPawnStructure(board), -32000, 32000));
+                }
+            }
+        });
+    }
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+void writeTable(FILE *out, const char *name, const int *values, int size) {
+    std::fprintf(out, "inline int %s[%d] =\n        {\n", name, size);
+    for (int row = 0; row < size / 8; row++) {
+        std::fprintf(out, "               ");
+        for (int column = 0; column < 8; column++) {
+            int index = row * 8 + column;
+            std::fprintf(out, "%4d%s", values[index], index + 1 < size ? "," : "");
+        }
+        std::fprintf(out, "\n");
+    }
+    std::fprintf(out, "        };\n\n");
+}
+
+bool writeHeader(const std::string &path, const std::vector<float> &weights, size_t positions, double loss, float k) {
+    FILE *out = std::fopen(path.c_str(), "w");
+    if (out == nullptr)
+        return false;
+
+    std::fprintf(out, "//\n// Generated by chesstune from %zu positions, mean squared error %.6f at K %.6f.\n//\n\n",
+                 positions, loss, k);
+    std::fprintf(out, "#ifndef CHESS_EVALTABLES_H\n#define CHESS_EVALTABLES_H\n\n");
+    std::fprintf(out, "//evaluation weights in centipawns. chesstune writes a file with this exact layout, so tuned "
+                      "weights are taken over by\n//replacing this header with its output\n\n");
+
+    std::fprintf(out, "//indexed by chess::PieceType, both sides always have their king so it has no value here\n");
+    std::fprintf(out, "inline int materialValues[5] = {");
+    for (int type = 0; type < 5; type++)
+        std::fprintf(out, "%s%d", type > 0 ? ", " : "", static_cast<int>(std::lround(weights[PIECE_SQUARE_WEIGHTS + type])));
+    std::fprintf(out, "};\n\n");
+
+    std::fprintf(out, "//piece-square tables, laid out rank 8 first as white sees the board\n");
+    for (int type = 0; type < 6; type++) {
+        int values[64];
+        for (int square = 0; square < 64; square++)
+            values[square] = static_cast<int>(std::lround(weights[type * 64 + square]));
+        writeTable(out, TABLE_NAMES[type], values, 64);
+    }
+
+    // carried over as it is: only MinMax::getKingSafety reads it and no evaluation calls that, so the data holds
+    // no gradient for it. it is also indexed by a count rather than summed, which a linear fit cannot express
+    std::fprintf(out, "//penalty by the number of squares around the king, the king's own square included, the enemy "
+                      "attacks\n");
+    std::fprintf(out, "inline int kingSafetySquares[10] = {");
+    for (int i = 0; i < 10; i++)
+        std::fprintf(out, "%s%d", i > 0 ? ", " : "", kingSafetySquares[i]);
+    std::fprintf(out, "};\n\n#endif //CHESS_EVALTABLES_H\n");
+
+    std::fclose(out);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    TuneOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            options.data = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        std::string value = argv[++i];
+
+        bool parsed = true;
+        if (arg == "--out")
+            options.out = value;
+        else if (arg == "--epochs")
+            parsed = xoxo::parseNumber(value, options.epochs);
+        else if (arg == "--rate")
+            parsed = xoxo::parseNumber(value, options.rate);
+        else if (arg == "--lambda")
+            parsed = xoxo::parseNumber(value, options.lambda);
+        else if (arg == "--threads")
+            parsed = xoxo::parseNumber(value, options.threads);
+        else if (arg == "--limit")
+            parsed = xoxo::parseNumber(value, options.limit);
+        else
+            parsed = false;
+
+        if (!parsed) {
+            usage();
+            return 1;
+        }
+    }
+    options.lambda = std::clamp(options.lambda, 0.0f, 1.0f);
+    options.threads = std::max(1u, options.threads);
+
+    if (options.data.empty()) {
+        usage();
+        return 1;
+    }
+
+    // every epoch reads the file front to back
+    xoxo::PackedPositionFile file(options.data, xoxo::FileAccess::SEQUENTIAL);
+    if (!file.isOpen() || file.size() == 0) {
+        std::fprintf(stderr, "no positions in %s\n", options.data.c_str());
+        return 1;
+    }
+
+    Dataset dataset;
+    dataset.records = file.data();
+    dataset.size = options.limit > 0 ? std::min(options.limit, file.size()) : file.size();
+
+    auto begin = Clock::now();
+    computeOffsets(dataset, options.threads);
+    std::fprintf(stderr, "%zu positions, pawn structure in %.1fs\n", dataset.size,
+                 std::chrono::duration<double>(Clock::now() - begin).count());
+
+    std::vector<float> weights(WEIGHT_COUNT);
+    for (int type = 0; type < 6; type++) {
+        for (int square = 0; square < 64; square++)
+            weights[type * 64 + square] = static_cast<float>(TABLES[type][square]);
+    }
+    for (int type = 0; type < 5; type++)
+        weights[PIECE_SQUARE_WEIGHTS + type] = static_cast<float>(materialValues[type]);
+
+    float k = fitScaling(dataset, weights, options);
+    double loss = pass(dataset, weights, k, options, nullptr);
+    std::fprintf(stderr, "K %.6f, starting error %.6f\n", k, loss);
+
+    // Adam, the weights are on very different scales of use so a plain step size would stall the rare squares
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    std::vector<double> gradient(WEIGHT_COUNT), moment(WEIGHT_COUNT, 0.0), velocity(WEIGHT_COUNT, 0.0);
+
+    for (int epoch = 1; epoch <= options.epochs; epoch++) {
+        auto epochBegin = Clock::now();
+        loss = pass(dataset, weights, k, options, &gradient);
+
+        double correction1 = 1.0 - std::pow(beta1, epoch);
+        double correction2 = 1.0 - std::pow(beta2, epoch);
+        for (int w = 0; w < WEIGHT_COUNT; w++) {
+            moment[w] = beta1 * moment[w] + (1.0 - beta1) * gradient[w];
+            velocity[w] = beta2 * velocity[w] + (1.0 - beta2) * gradient[w] * gradient[w];
+            double step = (moment[w] / correction1) / (std::sqrt(velocity[w] / correction2) + epsilon);
+            weights[w] -= static_cast<float>(options.rate * step);
+        }
+
+        if (epoch == 1 || epoch % 10 == 0 || epoch == options.epochs) {
+            double seconds = std::chrono::duration<double>(Clock::now() - epochBegin).count();
+            std::fprintf(stderr, "epoch %d, error %.6f, %.2fs per pass, %.1fM positions/s\n", epoch, loss, seconds,
+                         dataset.size / seconds / 1e6);
+        }
+    }
+
+    loss = pass(dataset, weights, k, options, nullptr);
+    if (!writeHeader(options.out, weights, dataset.size, loss, k)) {
+        std::fprintf(stderr, "cannot write %s\n", options.out.c_str());
+        return 1;
+    }
+
+    std::fprintf(stderr, "final error %.6f, tables written to %s\n", loss, options.out.c_str());
+    return 0;
+}